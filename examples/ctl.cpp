@@ -25,19 +25,31 @@
 
 #include <behemoth/expr.hpp>
 #include <behemoth/enumerator.hpp>
+#include <behemoth/parallel_enumerator.hpp>
+#include <behemoth/distributed_enumerator.hpp>
+#include <behemoth/ctl.hpp>
 #include <cli11/CLI11.hpp>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 class counting_enumerator : public behemoth::enumerator
 {
 public:
-  counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, const behemoth::rules_t& rules, int max_cost )
+  counting_enumerator( behemoth::context& ctx, const behemoth::basic_expr_printer<behemoth::context>& printer, behemoth::ctl_model_checker *checker, const behemoth::rules_t& rules, int max_cost )
     : enumerator( ctx, rules, max_cost )
     , printer( printer )
+    , checker( checker )
   {}
 
   virtual void on_concrete_expression( behemoth::cexpr_t e ) override
   {
+    if ( checker && !checker->holds( e.first ) )
+    {
+      return;
+    }
     std::cout << printer.as_string( e.first ) << ' ' << e.second << std::endl;
     ++number_of_expressions;
   }
@@ -45,48 +57,106 @@ public:
   void print_statistics()
   {
     std::cerr << "#enumerated expressions: " << number_of_expressions << std::endl;
+    std::cerr << fmt::format( "#nodes in context: {} ({:.1f} bytes/node)", ctx.size(), double( ctx.memory_usage() ) / ctx.size() ) << std::endl;
+    if ( checker )
+    {
+      std::cerr << fmt::format( "#cached results: {} ({} evictions)", checker->table().size(), checker->table().num_evictions() ) << std::endl;
+    }
   }
 
   unsigned long number_of_expressions = 0u;
-  const behemoth::expr_printer& printer;
+  const behemoth::basic_expr_printer<behemoth::context>& printer;
+  behemoth::ctl_model_checker *checker;
 }; // counting_enumerator
 
-class ctl_expr_printer : public behemoth::expr_printer
+template<typename Context>
+class parallel_counting_enumerator : public behemoth::basic_parallel_enumerator<Context>
 {
 public:
-  ctl_expr_printer( behemoth::context& ctx )
-    : expr_printer( ctx )
+  parallel_counting_enumerator( Context& ctx, const behemoth::basic_expr_printer<Context>& printer, const behemoth::rules_t& rules, int max_cost, unsigned num_threads )
+    : behemoth::basic_parallel_enumerator<Context>( ctx, rules, max_cost, num_threads )
+    , printer( printer )
+  {}
+
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    std::cout << printer.as_string( e.first ) << ' ' << e.second << std::endl;
+    ++number_of_expressions;
+  }
+
+  void print_statistics()
+  {
+    std::cerr << "#enumerated expressions: " << number_of_expressions << std::endl;
+    std::cerr << fmt::format( "#nodes in context: {} ({:.1f} bytes/node)", this->ctx.size(), double( this->ctx.memory_usage() ) / this->ctx.size() ) << std::endl;
+    std::cerr << "#threads: " << this->num_threads() << std::endl;
+  }
+
+  unsigned long number_of_expressions = 0u;
+  const behemoth::basic_expr_printer<Context>& printer;
+}; // parallel_counting_enumerator
+
+class distributed_counting_enumerator : public behemoth::distributed_enumerator
+{
+public:
+  distributed_counting_enumerator( behemoth::context& ctx, const behemoth::basic_expr_printer<behemoth::context>& printer, const behemoth::rules_t& rules, int max_cost, unsigned num_processes )
+    : distributed_enumerator( ctx, rules, max_cost, num_processes )
+    , printer( printer )
+  {}
+
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    std::cout << printer.as_string( e.first ) << ' ' << e.second << std::endl;
+    ++number_of_expressions;
+  }
+
+  void print_statistics()
+  {
+    std::cerr << "#enumerated expressions: " << number_of_expressions << std::endl;
+    std::cerr << fmt::format( "#nodes in context: {} ({:.1f} bytes/node)", ctx.size(), double( ctx.memory_usage() ) / ctx.size() ) << std::endl;
+    std::cerr << "#processes: " << num_workers << ", #duplicates: " << num_duplicates() << std::endl;
+  }
+
+  unsigned long number_of_expressions = 0u;
+  const behemoth::basic_expr_printer<behemoth::context>& printer;
+}; // distributed_counting_enumerator
+
+template<typename Context>
+class ctl_expr_printer : public behemoth::basic_expr_printer<Context>
+{
+public:
+  ctl_expr_printer( const Context& ctx )
+    : behemoth::basic_expr_printer<Context>( ctx )
   {}
 
   virtual std::string as_string( unsigned e ) const override
   {
-    const auto& expr = _ctx._exprs[ e ];
+    const auto children = this->_ctx.children( e );
 
-    if ( expr._children.size() == 0u )
+    if ( children.size() == 0u )
     {
-      return expr._name;
+      return this->_ctx.name( e );
     }
-    else if ( expr._children.size() == 1u )
+    else if ( children.size() == 1u )
     {
       return fmt::format( "{}({})",
-                          expr._name,
-                          as_string( expr._children[ 0u ] ) );
+                          this->_ctx.name( e ),
+                          as_string( children[ 0u ] ) );
     }
-    else if ( expr._children.size() == 2u )
+    else if ( children.size() == 2u )
     {
-      if ( expr._name == "EU" || expr._name == "AU" )
+      if ( this->_ctx.name( e ) == "EU" || this->_ctx.name( e ) == "AU" )
       {
         return fmt::format( "({}({})U({}))",
-                            expr._name.substr(0,1),
-                            as_string( expr._children[ 0u ] ),
-                            as_string( expr._children[ 1u ] ) );
+                            this->_ctx.name( e ).substr(0,1),
+                            as_string( children[ 0u ] ),
+                            as_string( children[ 1u ] ) );
       }
       else
       {
         return fmt::format( "(({}){}({}))",
-                            as_string( expr._children[ 0u ] ),
-                            expr._name,
-                            as_string( expr._children[ 1u ] ) );
+                            as_string( children[ 0u ] ),
+                            this->_ctx.name( e ),
+                            as_string( children[ 1u ] ) );
       }
     }
     else
@@ -96,23 +166,10 @@ public:
   }
 }; // ctl_expr_printer
 
-int main( int argc, char *argv[] )
+/* adds the CTL grammar and returns its non-terminal */
+template<typename Context>
+unsigned add_rules( Context& ctx, behemoth::rules_t& rules, int num_variables )
 {
-  behemoth::context ctx;
-  ctl_expr_printer printer( ctx );
-
-  CLI::App app{ "Demo application for enumerating simple CTL formulae over a fixed number of variables" };
-
-  int num_variables = 3;
-  app.add_option( "-v,--vars", num_variables, "Number of variables" );
-
-  int max_cost = 3;
-  app.add_option( "-c,--cost", max_cost, "Maximum bound on the number of rules" );
-
-  std::vector<behemoth::rule_t> rules;
-
-  CLI11_PARSE( app, argc, argv );
-
   const auto _N = ctx.make_fun( "_N" );
   const auto _not = ctx.make_fun( "!", { _N }, behemoth::expr_attr_enum::_no_double_application );
   const auto _and = ctx.make_fun( "&", { _N, _N }, behemoth::expr_attr_enum::_idempotent | behemoth::expr_attr_enum::_commutative );
@@ -146,7 +203,208 @@ int main( int argc, char *argv[] )
     rules.push_back( behemoth::rule_t{ _N, v } );
   }
 
-  counting_enumerator en( ctx, printer, rules, max_cost );
+  return _N;
+}
+
+/* Adds the Kripke structure in `filename` as a disjoint part of `kripke`.
+ * Each line is either `init <state>...` or `<state> <labels> <successor>...`
+ * where states are numbered from 0 and the i-th letter of the 0/1 word
+ * `labels` is the value of variable xi; lines starting with # are ignored.
+ * At least one state must be initial. */
+void read_kripke( const std::string& filename, unsigned num_variables, behemoth::kripke_structure& kripke )
+{
+  std::ifstream in( filename );
+  if ( !in )
+  {
+    throw std::runtime_error( fmt::format( "cannot open {}", filename ) );
+  }
+
+  std::vector<std::uint64_t> labels;
+  std::vector<std::pair<unsigned, unsigned>> transitions;
+  std::vector<unsigned> initial;
+  std::string line;
+  while ( std::getline( in, line ) )
+  {
+    std::istringstream words( line );
+    std::string head;
+    if ( !( words >> head ) || head[0u] == '#' )
+    {
+      continue;
+    }
+
+    unsigned state;
+    if ( head == "init" )
+    {
+      while ( words >> state )
+      {
+        initial.push_back( state );
+      }
+      continue;
+    }
+
+    std::string label;
+    if ( head.find_first_not_of( "0123456789" ) != std::string::npos )
+    {
+      throw std::runtime_error( fmt::format( "invalid state '{}' in {}", head, filename ) );
+    }
+    state = std::stoul( head );
+    if ( !( words >> label ) || label.size() != num_variables || label.find_first_not_of( "01" ) != std::string::npos )
+    {
+      throw std::runtime_error( fmt::format( "invalid labels of state {} in {}", state, filename ) );
+    }
+    if ( state >= labels.size() )
+    {
+      labels.resize( state + 1u );
+    }
+    for ( auto i = 0u; i < num_variables; ++i )
+    {
+      labels[state] |= std::uint64_t( label[i] == '1' ) << i;
+    }
+
+    unsigned successor;
+    while ( words >> successor )
+    {
+      transitions.emplace_back( state, successor );
+    }
+  }
+
+  /* every formula would hold in all of zero initial states */
+  if ( initial.empty() )
+  {
+    throw std::runtime_error( fmt::format( "no initial states in {}", filename ) );
+  }
+
+  const auto offset = kripke.num_states();
+  for ( const auto l : labels )
+  {
+    kripke.add_state( l );
+  }
+  for ( const auto& t : transitions )
+  {
+    kripke.add_transition( offset + t.first, offset + t.second );
+  }
+  for ( const auto s : initial )
+  {
+    kripke.add_initial_state( offset + s );
+  }
+}
+
+int main( int argc, char *argv[] )
+{
+  CLI::App app{ "Demo application for enumerating simple CTL formulae over a fixed number of variables" };
+
+  int num_variables = 3;
+  app.add_option( "-v,--vars", num_variables, "Number of variables" );
+
+  int max_cost = 3;
+  app.add_option( "-c,--cost", max_cost, "Maximum bound on the number of rules" );
+
+  unsigned num_threads = 1u;
+  app.add_option( "-j,--threads", num_threads, "Number of worker threads (0 for one per hardware thread)" );
+
+  unsigned num_processes = 0u;
+  app.add_option( "-p,--processes", num_processes, "Number of worker processes (0 to enumerate in this process)" );
+
+  bool iterative_deepening = false;
+  app.add_flag( "-i,--iterative-deepening", iterative_deepening, "Re-enumerate each cost layer depth-first instead of storing abstract expressions" );
+
+  std::vector<std::string> kripke_files;
+  app.add_option( "-k,--kripke", kripke_files, "Only report formulae that hold in the initial states of all Kripke structures in these files" );
+
+  std::size_t cache_size = 0u;
+  app.add_option( "--cache-size", cache_size, "Maximum MiB of cached subformula results (0 for no bound)" );
+
+  std::vector<behemoth::rule_t> rules;
+
+  CLI11_PARSE( app, argc, argv );
+
+  if ( num_threads != 1u && num_processes > 0u )
+  {
+    std::cerr << "--threads and --processes cannot be combined" << std::endl;
+    return 1;
+  }
+
+  if ( iterative_deepening && ( num_threads != 1u || num_processes > 0u ) )
+  {
+    std::cerr << "--iterative-deepening requires a single thread and process" << std::endl;
+    return 1;
+  }
+
+  if ( !kripke_files.empty() && ( num_threads != 1u || num_processes > 0u ) )
+  {
+    std::cerr << "--kripke requires a single thread and process" << std::endl;
+    return 1;
+  }
+
+  if ( num_threads != 1u )
+  {
+    behemoth::concurrent_context ctx;
+    ctl_expr_printer<behemoth::concurrent_context> printer( ctx );
+    const auto _N = add_rules( ctx, rules, num_variables );
+
+    parallel_counting_enumerator<behemoth::concurrent_context> en( ctx, printer, rules, max_cost, num_threads );
+    en.add_expression( _N );
+    en.run();
+    en.print_statistics();
+    return 0;
+  }
+
+  behemoth::context ctx;
+  ctl_expr_printer<behemoth::context> printer( ctx );
+  const auto _N = add_rules( ctx, rules, num_variables );
+
+  if ( num_processes > 0u )
+  {
+    distributed_counting_enumerator en( ctx, printer, rules, max_cost, num_processes );
+    en.add_expression( _N );
+    en.run();
+    en.print_statistics();
+    return 0;
+  }
+
+  std::unique_ptr<behemoth::kripke_structure> kripke;
+  std::unique_ptr<behemoth::ctl_model_checker> checker;
+  if ( !kripke_files.empty() )
+  {
+    kripke.reset( new behemoth::kripke_structure( num_variables ) );
+    try
+    {
+      for ( const auto& filename : kripke_files )
+      {
+        read_kripke( filename, num_variables, *kripke );
+      }
+    }
+    catch ( const std::exception& e )
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+    behemoth::node_table_params ps;
+    ps.max_bytes = cache_size << 20u;
+    checker.reset( new behemoth::ctl_model_checker( ctx, *kripke, behemoth::detect_simd_isa(), ps ) );
+    checker->add_operator( ctx.make_symbol( "!" ), behemoth::ctl_op::not_ );
+    checker->add_operator( ctx.make_symbol( "&" ), behemoth::ctl_op::and_ );
+    checker->add_operator( ctx.make_symbol( "|" ), behemoth::ctl_op::or_ );
+    checker->add_operator( ctx.make_symbol( "EG" ), behemoth::ctl_op::eg );
+    checker->add_operator( ctx.make_symbol( "EF" ), behemoth::ctl_op::ef );
+    checker->add_operator( ctx.make_symbol( "EX" ), behemoth::ctl_op::ex );
+    checker->add_operator( ctx.make_symbol( "EU" ), behemoth::ctl_op::eu );
+    checker->add_operator( ctx.make_symbol( "AG" ), behemoth::ctl_op::ag );
+    checker->add_operator( ctx.make_symbol( "AF" ), behemoth::ctl_op::af );
+    checker->add_operator( ctx.make_symbol( "AX" ), behemoth::ctl_op::ax );
+    checker->add_operator( ctx.make_symbol( "AU" ), behemoth::ctl_op::au );
+    for ( auto i = 0; i < num_variables; ++i )
+    {
+      checker->add_variable( ctx.make_symbol( fmt::format( "x{}", i ) ), i );
+    }
+  }
+
+  counting_enumerator en( ctx, printer, checker.get(), rules, max_cost );
+  if ( iterative_deepening )
+  {
+    en.use_iterative_deepening();
+  }
   en.add_expression( _N );
   while ( en.is_running() )
   {
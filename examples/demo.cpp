@@ -25,50 +25,181 @@
 
 #include <behemoth/expr.hpp>
 #include <behemoth/enumerator.hpp>
+#include <behemoth/parallel_enumerator.hpp>
+#include <behemoth/truth_table.hpp>
 #include <cli11/CLI11.hpp>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
-class counting_enumerator : public behemoth::enumerator
+/* prints and counts the reported expressions, optionally only the first
+ * expression of every Boolean function */
+template<typename Context>
+class expression_reporter
 {
 public:
-  counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, const behemoth::rules_t& rules, int max_cost )
-    : enumerator( ctx, rules, max_cost )
+  expression_reporter( const Context& ctx, const behemoth::basic_expr_printer<Context>& printer, behemoth::truth_table_filter *filter = nullptr )
+    : reporter_ctx( ctx )
     , printer( printer )
+    , filter( filter )
   {}
 
-  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  void report( behemoth::cexpr_t e )
   {
+    if ( filter && !filter->insert( e.first ) )
+    {
+      return;
+    }
     std::cout << printer.as_string( e.first ) << ' ' << e.second << std::endl;
     ++number_of_expressions;
   }
 
+  void report( behemoth::cexpr_span batch )
+  {
+    for ( const auto& e : batch )
+    {
+      if ( filter && !filter->insert( e.first ) )
+      {
+        continue;
+      }
+      std::cout << printer.as_string( e.first ) << ' ' << e.second << '\n';
+      ++number_of_expressions;
+    }
+    std::cout.flush();
+  }
+
   void print_statistics()
   {
     std::cerr << "#enumerated expressions: " << number_of_expressions << std::endl;
+    std::cerr << fmt::format( "#nodes in context: {} ({:.1f} bytes/node)", reporter_ctx.size(), double( reporter_ctx.memory_usage() ) / reporter_ctx.size() ) << std::endl;
   }
 
   unsigned long number_of_expressions = 0u;
-  const behemoth::expr_printer& printer;
+
+private:
+  const Context& reporter_ctx;
+  const behemoth::basic_expr_printer<Context>& printer;
+  behemoth::truth_table_filter *filter;
+}; // expression_reporter
+
+template<typename Frontier>
+class counting_enumerator : public behemoth::basic_enumerator<Frontier>, public expression_reporter<behemoth::context>
+{
+public:
+  counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, behemoth::truth_table_filter *filter, const behemoth::rules_t& rules, int max_cost, Frontier frontier )
+    : behemoth::basic_enumerator<Frontier>( ctx, rules, max_cost, std::move( frontier ) )
+    , expression_reporter( ctx, printer, filter )
+  {}
+
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    report( e );
+  }
+
+  virtual void on_concrete_expressions( behemoth::cexpr_span batch ) override
+  {
+    report( batch );
+  }
 }; // counting_enumerator
 
-int main( int argc, char *argv[] )
+/* same as counting_enumerator, with hooks resolved at compile time */
+template<typename Frontier>
+class static_counting_enumerator : public behemoth::static_enumerator<static_counting_enumerator<Frontier>, Frontier>, public expression_reporter<behemoth::context>
 {
-  using namespace behemoth;
+public:
+  static_counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, behemoth::truth_table_filter *filter, const behemoth::rules_t& rules, int max_cost, Frontier frontier )
+    : behemoth::static_enumerator<static_counting_enumerator<Frontier>, Frontier>( ctx, rules, max_cost, std::move( frontier ) )
+    , expression_reporter( ctx, printer, filter )
+  {}
 
-  context ctx;
-  expr_printer printer( ctx );
+  void on_concrete_expression( behemoth::cexpr_t e )
+  {
+    report( e );
+  }
 
-  CLI::App app{ "Demo application for enumeraing AND-NOT structures over a fixed number of variables" };
+  void on_concrete_expressions( behemoth::cexpr_span batch )
+  {
+    report( batch );
+  }
+}; // static_counting_enumerator
 
-  int num_variables = 3;
-  app.add_option( "-v,--vars", num_variables, "Number of variables" );
+template<typename Context>
+class parallel_counting_enumerator : public behemoth::basic_parallel_enumerator<Context>, public expression_reporter<Context>
+{
+public:
+  parallel_counting_enumerator( Context& ctx, const behemoth::basic_expr_printer<Context>& printer, const behemoth::rules_t& rules, int max_cost, unsigned num_threads )
+    : behemoth::basic_parallel_enumerator<Context>( ctx, rules, max_cost, num_threads )
+    , expression_reporter<Context>( ctx, printer )
+  {}
 
-  int max_cost = 5;
-  app.add_option( "-c,--cost", max_cost, "Maximum bound on the number of rules" );
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    this->report( e );
+  }
 
-  std::vector<rule_t> rules;
+  void print_statistics()
+  {
+    expression_reporter<Context>::print_statistics();
+    std::cerr << "#threads: " << this->num_threads() << std::endl;
+  }
+}; // parallel_counting_enumerator
 
-  CLI11_PARSE( app, argc, argv );
+template<template<typename> class Enumerator, typename Frontier>
+void enumerate( behemoth::context& ctx, const behemoth::expr_printer& printer, behemoth::truth_table_filter *filter, const behemoth::rules_t& rules, unsigned start, int max_cost, Frontier frontier, bool iterative_deepening, unsigned batch_size )
+{
+  Enumerator<Frontier> en( ctx, printer, filter, rules, max_cost, std::move( frontier ) );
+  if ( iterative_deepening )
+  {
+    en.use_iterative_deepening();
+  }
+  en.add_expression( start );
+  while ( en.is_running() )
+  {
+    if ( batch_size > 0u )
+    {
+      en.deduce_batch( batch_size );
+    }
+    else
+    {
+      en.deduce();
+    }
+  }
+  en.print_statistics();
+}
+
+/* enumerates with the frontier selected by `queue` */
+template<template<typename> class Enumerator>
+void enumerate( const std::string& queue, behemoth::context& ctx, const behemoth::expr_printer& printer, behemoth::truth_table_filter *filter, const behemoth::rules_t& rules, unsigned start, int max_cost, int beam_width, bool iterative_deepening, unsigned batch_size )
+{
+  using namespace behemoth;
+
+  if ( queue == "bucket" )
+  {
+    enumerate<Enumerator>( ctx, printer, filter, rules, start, max_cost, bucket_frontier( ctx ), iterative_deepening, batch_size );
+  }
+  else if ( queue == "bfs" )
+  {
+    enumerate<Enumerator>( ctx, printer, filter, rules, start, max_cost, bfs_frontier( ctx ), iterative_deepening, batch_size );
+  }
+  else if ( queue == "dfs" )
+  {
+    enumerate<Enumerator>( ctx, printer, filter, rules, start, max_cost, dfs_frontier( ctx ), iterative_deepening, batch_size );
+  }
+  else if ( queue == "beam" )
+  {
+    enumerate<Enumerator>( ctx, printer, filter, rules, start, max_cost, beam_frontier( ctx, beam_width ), iterative_deepening, batch_size );
+  }
+  else
+  {
+    enumerate<Enumerator>( ctx, printer, filter, rules, start, max_cost, heap_frontier( ctx ), iterative_deepening, batch_size );
+  }
+}
+
+/* adds the AND-NOT grammar and returns its non-terminal */
+template<typename Context>
+unsigned add_rules( Context& ctx, behemoth::rules_t& rules, int num_variables )
+{
+  using namespace behemoth;
 
   const auto _N = ctx.make_fun( "_N" );
   const auto _not = ctx.make_fun( "not", { _N }, expr_attr_enum::_no_double_application );
@@ -83,13 +214,95 @@ int main( int argc, char *argv[] )
     rules.push_back( rule_t{ _N, v } );
   }
 
-  counting_enumerator en( ctx, printer, rules, max_cost );
-  en.add_expression( _N );
-  while ( en.is_running() )
+  return _N;
+}
+
+int main( int argc, char *argv[] )
+{
+  using namespace behemoth;
+
+  CLI::App app{ "Demo application for enumeraing AND-NOT structures over a fixed number of variables" };
+
+  int num_variables = 3;
+  app.add_option( "-v,--vars", num_variables, "Number of variables" );
+
+  int max_cost = 5;
+  app.add_option( "-c,--cost", max_cost, "Maximum bound on the number of rules" );
+
+  std::string queue = "heap";
+  auto *queue_option = app.add_set( "-q,--queue", queue, { "heap", "bucket", "bfs", "dfs", "beam" }, "Frontier for abstract expressions" );
+
+  unsigned num_threads = 1u;
+  app.add_option( "-j,--threads", num_threads, "Number of worker threads (0 for one per hardware thread)" );
+
+  bool iterative_deepening = false;
+  auto *iterative_deepening_option = app.add_flag( "-i,--iterative-deepening", iterative_deepening, "Re-enumerate each cost layer depth-first instead of storing abstract expressions" );
+
+  unsigned batch_size = 0u;
+  auto *batch_option = app.add_option( "-b,--batch", batch_size, "Refine up to this many candidates of the same cost per step (0 for one)" );
+
+  bool static_dispatch = false;
+  auto *static_option = app.add_flag( "--static", static_dispatch, "Resolve the enumeration hooks at compile time instead of by virtual calls" );
+
+  int beam_width = 1024;
+  auto *beam_width_option = app.add_option( "--beam-width", beam_width, "Maximum number of abstract expressions per cost for the beam frontier" );
+
+  bool unique_functions = false;
+  auto *unique_functions_option = app.add_flag( "-u,--unique-functions", unique_functions, "Only report the first expression of every Boolean function, which is a cheapest one for the heap, bucket, and bfs queues and with iterative deepening; only the output is filtered, the search is not pruned" );
+
+  std::vector<rule_t> rules;
+
+  CLI11_PARSE( app, argc, argv );
+
+  if ( num_threads != 1u )
   {
-    en.deduce();
+    /* the parallel enumerator has a fixed frontier and no filter */
+    for ( const auto *option : { queue_option, iterative_deepening_option, batch_option, static_option, beam_width_option, unique_functions_option } )
+    {
+      if ( option->count() > 0u )
+      {
+        std::cerr << option->single_name() << " requires a single thread" << std::endl;
+        return 1;
+      }
+    }
+
+    concurrent_context ctx;
+    basic_expr_printer<concurrent_context> printer( ctx );
+    const auto _N = add_rules( ctx, rules, num_variables );
+
+    parallel_counting_enumerator<concurrent_context> en( ctx, printer, rules, max_cost, num_threads );
+    en.add_expression( _N );
+    en.run();
+    en.print_statistics();
+    return 0;
+  }
+
+  context ctx;
+  expr_printer printer( ctx );
+  const auto _N = add_rules( ctx, rules, num_variables );
+
+  std::unique_ptr<truth_table_evaluator> eval;
+  std::unique_ptr<truth_table_filter> filter;
+  if ( unique_functions )
+  {
+    eval.reset( new truth_table_evaluator( ctx, num_variables ) );
+    eval->add_operator( ctx.make_symbol( "not" ), boolean_op::not_ );
+    eval->add_operator( ctx.make_symbol( "and" ), boolean_op::and_ );
+    for ( auto i = 0; i < num_variables; ++i )
+    {
+      eval->add_variable( ctx.make_symbol( fmt::format( "x{}", i ) ), i );
+    }
+    filter.reset( new truth_table_filter( *eval ) );
+  }
+
+  if ( static_dispatch )
+  {
+    enumerate<static_counting_enumerator>( queue, ctx, printer, filter.get(), rules, _N, max_cost, std::max( beam_width, 1 ), iterative_deepening, batch_size );
+  }
+  else
+  {
+    enumerate<counting_enumerator>( queue, ctx, printer, filter.get(), rules, _N, max_cost, std::max( beam_width, 1 ), iterative_deepening, batch_size );
   }
-  en.print_statistics();
 
   return 0;
 }
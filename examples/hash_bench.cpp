@@ -0,0 +1,165 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behemoth/expr.hpp>
+#include <behemoth/enumerator.hpp>
+#include <cli11/CLI11.hpp>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+
+/* the boost-style hash combine used before expr_hash, seeded with the hash
+ * of the symbol name */
+struct legacy_expr_hash
+{
+  std::size_t operator()( unsigned e ) const
+  {
+    auto seed = std::hash<std::string>{}( ctx.name( e ) );
+    for ( const auto c : ctx.children( e ) )
+    {
+      seed ^= (std::hash<unsigned>{}(c) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 ));
+    }
+    return seed;
+  }
+
+  const behemoth::context& ctx;
+}; // legacy_expr_hash
+
+/* inserts all nodes of `ctx` into a fresh table keyed by `hash` */
+template<typename Hash>
+void report( const std::string& grammar, const std::string& hash_name, const behemoth::context& ctx, Hash&& hash )
+{
+  std::vector<std::size_t> values;
+  behemoth::strash_table table;
+  for ( auto e = 0u; e < ctx.size(); ++e )
+  {
+    values.push_back( hash( e ) );
+    table.insert( values.back(), e, hash );
+  }
+
+  std::sort( values.begin(), values.end() );
+  const auto distinct = std::unique( values.begin(), values.end() ) - values.begin();
+
+  const auto st = table.statistics( hash );
+  std::cout << fmt::format( "{:5} {:7} nodes: {:9} collisions: {:6.3f}% avg probe: {:7.3f} max probe: {:6}",
+                            grammar, hash_name, st.size,
+                            100.0 * ( st.size - distinct ) / st.size,
+                            st.avg_probe_length, st.max_probe_length ) << std::endl;
+}
+
+void enumerate( behemoth::context& ctx, unsigned start, const behemoth::rules_t& rules, int max_cost )
+{
+  behemoth::enumerator en( ctx, rules, max_cost );
+  en.add_expression( start );
+  while ( en.is_running() )
+  {
+    en.deduce( 1024u );
+  }
+}
+
+void add_variables( behemoth::context& ctx, behemoth::rules_t& rules, unsigned nonterminal, int num_variables )
+{
+  for ( auto i = 0; i < num_variables; ++i )
+  {
+    rules.push_back( behemoth::rule_t{ nonterminal, ctx.make_fun( fmt::format( "x{}", i ) ) } );
+  }
+}
+
+void run( const std::string& grammar, behemoth::context& ctx, unsigned start, const behemoth::rules_t& rules, int max_cost )
+{
+  enumerate( ctx, start, rules, max_cost );
+  report( grammar, "expr", ctx, [&]( unsigned e ){
+      const auto children = ctx.children( e );
+      return behemoth::expr_hash{}( ctx.symbol( e ), children.begin(), children.size() );
+    } );
+  report( grammar, "legacy", ctx, legacy_expr_hash{ ctx } );
+}
+
+int main( int argc, char *argv[] )
+{
+  using namespace behemoth;
+
+  CLI::App app{ "Reports collision rates and probe lengths of structural hashing for the demo, LTL, and CTL grammars" };
+
+  int num_variables = 3;
+  app.add_option( "-v,--vars", num_variables, "Number of variables" );
+
+  int demo_cost = 7;
+  app.add_option( "--demo-cost", demo_cost, "Maximum bound on the number of rules for the AND-NOT grammar" );
+
+  int ltl_cost = 5;
+  app.add_option( "--ltl-cost", ltl_cost, "Maximum bound on the number of rules for the LTL grammar" );
+
+  int ctl_cost = 4;
+  app.add_option( "--ctl-cost", ctl_cost, "Maximum bound on the number of rules for the CTL grammar" );
+
+  CLI11_PARSE( app, argc, argv );
+
+  {
+    context ctx;
+    rules_t rules;
+    const auto _N = ctx.make_fun( "_N" );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "not", { _N }, expr_attr_enum::_no_double_application ), 0u } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "and", { _N, _N }, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) } );
+    add_variables( ctx, rules, _N, num_variables );
+    run( "demo", ctx, _N, rules, demo_cost );
+  }
+
+  {
+    context ctx;
+    rules_t rules;
+    const auto _N = ctx.make_fun( "_N" );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "!", { _N }, expr_attr_enum::_no_double_application ), 0u } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "&", { _N, _N }, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "|", { _N, _N }, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "G", { _N }, expr_attr_enum::_no_double_application ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "F", { _N }, expr_attr_enum::_no_double_application ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "X", { _N } ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "U", { _N, _N }, expr_attr_enum::_idempotent ) } );
+    add_variables( ctx, rules, _N, num_variables );
+    run( "ltl", ctx, _N, rules, ltl_cost );
+  }
+
+  {
+    context ctx;
+    rules_t rules;
+    const auto _N = ctx.make_fun( "_N" );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "!", { _N }, expr_attr_enum::_no_double_application ), 0u } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "&", { _N, _N }, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) } );
+    rules.push_back( rule_t{ _N, ctx.make_fun( "|", { _N, _N }, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) } );
+    for ( const auto& q : { "E", "A" } )
+    {
+      rules.push_back( rule_t{ _N, ctx.make_fun( fmt::format( "{}G", q ), { _N }, expr_attr_enum::_no_double_application ) } );
+      rules.push_back( rule_t{ _N, ctx.make_fun( fmt::format( "{}F", q ), { _N }, expr_attr_enum::_no_double_application ) } );
+      rules.push_back( rule_t{ _N, ctx.make_fun( fmt::format( "{}X", q ), { _N } ) } );
+      rules.push_back( rule_t{ _N, ctx.make_fun( fmt::format( "{}U", q ), { _N, _N }, expr_attr_enum::_idempotent ) } );
+    }
+    add_variables( ctx, rules, _N, num_variables );
+    run( "ctl", ctx, _N, rules, ctl_cost );
+  }
+
+  return 0;
+}
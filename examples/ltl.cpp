@@ -25,19 +25,30 @@
 
 #include <behemoth/expr.hpp>
 #include <behemoth/enumerator.hpp>
+#include <behemoth/ltl.hpp>
 #include <cli11/CLI11.hpp>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 class counting_enumerator : public behemoth::enumerator
 {
 public:
-  counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, const behemoth::rules_t& rules, int max_cost )
+  counting_enumerator( behemoth::context& ctx, const behemoth::expr_printer& printer, behemoth::ltl_evaluator *eval, std::size_t num_traces, const behemoth::rules_t& rules, int max_cost )
     : enumerator( ctx, rules, max_cost )
     , printer( printer )
+    , eval( eval )
+    , num_traces( num_traces )
   {}
 
   virtual void on_concrete_expression( behemoth::cexpr_t e ) override
   {
+    if ( eval && eval->count_traces( e.first ) != num_traces )
+    {
+      return;
+    }
     std::cout << printer.as_string( e.first ) << ' ' << e.second << std::endl;
     ++number_of_expressions;
   }
@@ -45,12 +56,64 @@ public:
   void print_statistics()
   {
     std::cerr << "#enumerated expressions: " << number_of_expressions << std::endl;
+    std::cerr << fmt::format( "#nodes in context: {} ({:.1f} bytes/node)", ctx.size(), double( ctx.memory_usage() ) / ctx.size() ) << std::endl;
+    if ( eval )
+    {
+      std::cerr << fmt::format( "#cached results: {} ({} evictions)", eval->table().size(), eval->table().num_evictions() ) << std::endl;
+    }
   }
 
   unsigned long number_of_expressions = 0u;
   const behemoth::expr_printer& printer;
+  behemoth::ltl_evaluator *eval;
+  std::size_t num_traces;
 }; // counting_enumerator
 
+/* reads one trace per line, each step being a word of 0s and 1s whose i-th
+ * letter is the value of variable xi; lines starting with # are ignored */
+behemoth::trace_set read_traces( const std::string& filename, unsigned num_variables )
+{
+  std::ifstream in( filename );
+  if ( !in )
+  {
+    throw std::runtime_error( fmt::format( "cannot open {}", filename ) );
+  }
+
+  behemoth::trace_set traces( num_variables );
+  std::string line;
+  while ( std::getline( in, line ) )
+  {
+    std::istringstream words( line );
+    std::vector<std::uint64_t> steps;
+    std::string step;
+    while ( words >> step && step[0u] != '#' )
+    {
+      if ( step.size() != num_variables || step.find_first_not_of( "01" ) != std::string::npos )
+      {
+        throw std::runtime_error( fmt::format( "invalid step '{}' in {}", step, filename ) );
+      }
+
+      std::uint64_t value = 0u;
+      for ( auto i = 0u; i < num_variables; ++i )
+      {
+        value |= std::uint64_t( step[i] == '1' ) << i;
+      }
+      steps.push_back( value );
+    }
+    if ( !steps.empty() )
+    {
+      traces.add_trace( steps );
+    }
+  }
+
+  /* every formula would hold on all of zero traces */
+  if ( traces.num_traces() == 0u )
+  {
+    throw std::runtime_error( fmt::format( "no traces in {}", filename ) );
+  }
+  return traces;
+}
+
 class ltl_expr_printer : public behemoth::expr_printer
 {
 public:
@@ -60,24 +123,24 @@ public:
 
   virtual std::string as_string( unsigned e ) const override
   {
-    const auto& expr = _ctx._exprs[ e ];
+    const auto children = _ctx.children( e );
 
-    if ( expr._children.size() == 0u )
+    if ( children.size() == 0u )
     {
-      return expr._name;
+      return _ctx.name( e );
     }
-    else if ( expr._children.size() == 1u )
+    else if ( children.size() == 1u )
     {
       return fmt::format( "{}({})",
-                          expr._name,
-                          as_string( expr._children[ 0u ] ) );
+                          _ctx.name( e ),
+                          as_string( children[ 0u ] ) );
     }
-    else if ( expr._children.size() == 2u )
+    else if ( children.size() == 2u )
     {
       return fmt::format( "(({}){}({}))",
-                          as_string( expr._children[ 0u ] ),
-                          expr._name,
-                          as_string( expr._children[ 1u ] ) );
+                          as_string( children[ 0u ] ),
+                          _ctx.name( e ),
+                          as_string( children[ 1u ] ) );
     }
     else
     {
@@ -100,6 +163,15 @@ int main( int argc, char *argv[] )
   int max_cost = 5;
   app.add_option( "-c,--cost", max_cost, "Maximum bound on the number of rules" );
 
+  bool iterative_deepening = false;
+  app.add_flag( "-i,--iterative-deepening", iterative_deepening, "Re-enumerate each cost layer depth-first instead of storing abstract expressions" );
+
+  std::string traces_file;
+  app.add_option( "-t,--traces", traces_file, "Only report formulae that hold on all traces in this file (one trace of 0/1 steps per line)" );
+
+  std::size_t cache_size = 0u;
+  app.add_option( "--cache-size", cache_size, "Maximum MiB of cached subformula results (0 for no bound)" );
+
   std::vector<behemoth::rule_t> rules;
 
   CLI11_PARSE( app, argc, argv );
@@ -127,7 +199,41 @@ int main( int argc, char *argv[] )
     rules.push_back( behemoth::rule_t{ _N, v } );
   }
 
-  counting_enumerator en( ctx, printer, rules, max_cost );
+  std::unique_ptr<behemoth::trace_set> traces;
+  std::unique_ptr<behemoth::ltl_evaluator> eval;
+  if ( !traces_file.empty() )
+  {
+    try
+    {
+      traces.reset( new behemoth::trace_set( read_traces( traces_file, num_variables ) ) );
+    }
+    catch ( const std::exception& e )
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+    behemoth::node_table_params ps;
+    ps.max_bytes = cache_size << 20u;
+    eval.reset( new behemoth::ltl_evaluator( ctx, *traces, behemoth::detect_simd_isa(), ps ) );
+    eval->add_operator( ctx.make_symbol( "!" ), behemoth::ltl_op::not_ );
+    eval->add_operator( ctx.make_symbol( "&" ), behemoth::ltl_op::and_ );
+    eval->add_operator( ctx.make_symbol( "|" ), behemoth::ltl_op::or_ );
+    eval->add_operator( ctx.make_symbol( "G" ), behemoth::ltl_op::globally );
+    eval->add_operator( ctx.make_symbol( "F" ), behemoth::ltl_op::eventually );
+    eval->add_operator( ctx.make_symbol( "X" ), behemoth::ltl_op::next );
+    eval->add_operator( ctx.make_symbol( "U" ), behemoth::ltl_op::until );
+    for ( auto i = 0; i < num_variables; ++i )
+    {
+      eval->add_variable( ctx.make_symbol( fmt::format( "x{}", i ) ), i );
+    }
+  }
+
+  counting_enumerator en( ctx, printer, eval.get(), traces ? traces->num_traces() : 0u, rules, max_cost );
+  if ( iterative_deepening )
+  {
+    en.use_iterative_deepening();
+  }
   en.add_expression( _N );
   while ( en.is_running() )
   {
@@ -0,0 +1,331 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define BEHEMOTH_ARENA_MMAP
+#endif
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * arena                                                                      *
+ ******************************************************************************/
+
+struct arena_params
+{
+  /* upper bound on the bytes of one chunk handed out to an arena_vector */
+  std::size_t chunk_size = 1u << 20u;
+
+  /* back regions by transparent huge pages (where supported) */
+  bool huge_pages = false;
+}; // arena_params
+
+/* Bump allocator for storage that lives as long as its owner.
+ *
+ * Memory is requested from the system in regions of a few chunks (2 MiB
+ * aligned regions when huge pages are enabled) and handed out in
+ * chunks by bumping a pointer; nothing is freed before the arena is
+ * destroyed.
+ */
+class arena
+{
+public:
+  explicit arena( const arena_params& ps = {} )
+    : _ps( ps )
+  {
+    if ( _ps.chunk_size < 64u )
+    {
+      throw std::invalid_argument( "arena chunk size must be at least 64 bytes" );
+    }
+  }
+
+  ~arena()
+  {
+    for ( const auto& r : _regions )
+    {
+      release( r.first, r.second );
+    }
+  }
+
+  arena( const arena& ) = delete;
+  arena& operator=( const arena& ) = delete;
+
+  /* returns `bytes` bytes aligned to 64 bytes */
+  void *allocate( std::size_t bytes )
+  {
+    bytes = ( bytes + 63u ) & ~std::size_t( 63u );
+    if ( std::size_t( _end - _begin ) < bytes )
+    {
+      add_region( bytes );
+    }
+
+    auto *p = _begin;
+    _begin += bytes;
+    _used += bytes;
+    return p;
+  }
+
+  const arena_params& params() const
+  {
+    return _ps;
+  }
+
+  /* number of allocations requested from the system */
+  std::size_t num_regions() const
+  {
+    return _regions.size();
+  }
+
+  /* bytes requested from the system */
+  std::size_t memory_usage() const
+  {
+    return _reserved;
+  }
+
+  /* bytes handed out */
+  std::size_t used() const
+  {
+    return _used;
+  }
+
+private:
+  static constexpr std::size_t huge_page_size = 2u << 20u;
+
+  /* chunks per region; pages that are never touched are not backed */
+  static constexpr std::size_t chunks_per_region = 4u;
+
+  void add_region( std::size_t bytes )
+  {
+    auto size = std::max( bytes, chunks_per_region * _ps.chunk_size );
+    if ( _ps.huge_pages )
+    {
+      size = ( size + huge_page_size - 1u ) & ~( huge_page_size - 1u );
+    }
+
+    auto *p = static_cast<char*>( reserve( size ) );
+    _regions.emplace_back( p, size );
+    _reserved += size;
+    _begin = p;
+    _end = p + size;
+  }
+
+  void *reserve( std::size_t size )
+  {
+#ifdef BEHEMOTH_ARENA_MMAP
+    if ( _ps.huge_pages )
+    {
+      /* over-allocate to cut out a huge page aligned range */
+      auto *raw = static_cast<char*>( map( size + huge_page_size ) );
+      const auto offset = ( huge_page_size - reinterpret_cast<std::uintptr_t>( raw ) % huge_page_size ) % huge_page_size;
+      if ( offset > 0u )
+      {
+        munmap( raw, offset );
+      }
+      munmap( raw + offset + size, huge_page_size - offset );
+#ifdef MADV_HUGEPAGE
+      madvise( raw + offset, size, MADV_HUGEPAGE );
+#endif
+      return raw + offset;
+    }
+    return map( size );
+#else
+    auto *p = std::malloc( size );
+    if ( !p )
+    {
+      throw std::bad_alloc();
+    }
+    return p;
+#endif
+  }
+
+#ifdef BEHEMOTH_ARENA_MMAP
+  static void *map( std::size_t size )
+  {
+    auto *p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( p == MAP_FAILED )
+    {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+#endif
+
+  static void release( char *p, std::size_t size )
+  {
+#ifdef BEHEMOTH_ARENA_MMAP
+    munmap( p, size );
+#else
+    (void)size;
+    std::free( p );
+#endif
+  }
+
+  arena_params _ps;
+  std::vector<std::pair<char*, std::size_t>> _regions;
+  char *_begin = nullptr;
+  char *_end = nullptr;
+  std::size_t _reserved = 0u;
+  std::size_t _used = 0u;
+}; // arena
+
+/******************************************************************************
+ * arena_vector                                                               *
+ ******************************************************************************/
+
+/* Append-only array of trivially copyable elements stored in arena chunks.
+ *
+ * Each chunk holds a power of two many elements, so indexing is a shift and
+ * a mask, and elements never move: pointers stay valid while the vector
+ * grows.  Shrinking keeps the chunks for reuse.
+ */
+template<typename T>
+class arena_vector
+{
+  static_assert( std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                 "arena_vector requires trivial elements" );
+
+public:
+  explicit arena_vector( arena& a )
+    : _arena( &a )
+  {
+    while ( ( std::size_t( 2u ) << _log ) * sizeof( T ) <= a.params().chunk_size )
+    {
+      ++_log;
+    }
+    _mask = ( std::size_t( 1u ) << _log ) - 1u;
+  }
+
+  T& operator[]( std::size_t i )
+  {
+    return _chunks[i >> _log][i & _mask];
+  }
+
+  const T& operator[]( std::size_t i ) const
+  {
+    return _chunks[i >> _log][i & _mask];
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  std::size_t capacity() const
+  {
+    return _chunks.size() << _log;
+  }
+
+  /* maximum number of elements that `append` can place contiguously */
+  std::size_t chunk_capacity() const
+  {
+    return _mask + 1u;
+  }
+
+  void push_back( const T& value )
+  {
+    if ( _size == capacity() )
+    {
+      add_chunk();
+    }
+    (*this)[_size++] = value;
+  }
+
+  /* appends `n` contiguous elements and returns the index of the first;
+   * the remainder of the current chunk is skipped if they do not fit, and
+   * more than chunk_capacity() elements throw std::length_error */
+  std::size_t append( const T *values, std::size_t n )
+  {
+    if ( n > chunk_capacity() )
+    {
+      throw std::length_error( "arena_vector::append exceeds the chunk capacity" );
+    }
+    if ( n == 0u )
+    {
+      return _size;
+    }
+    if ( ( _size & _mask ) + n > chunk_capacity() && ( _size & _mask ) != 0u )
+    {
+      _size = ( _size | _mask ) + 1u;
+    }
+    while ( _size + n > capacity() )
+    {
+      add_chunk();
+    }
+
+    const auto first = _size;
+    std::copy( values, values + n, &(*this)[first] );
+    _size += n;
+    return first;
+  }
+
+  /* Reserves the chunk directory for `n` elements without allocating the
+   * chunks.  Up to this size, appending never moves the directory, hence
+   * elements that were published to other threads may be read while one
+   * thread appends. */
+  void reserve( std::size_t n )
+  {
+    _chunks.reserve( ( n + _mask ) >> _log );
+  }
+
+  /* drops all elements from index `n` on */
+  void truncate( std::size_t n )
+  {
+    assert( n <= _size );
+    _size = n;
+  }
+
+private:
+  void add_chunk()
+  {
+    _chunks.push_back( static_cast<T*>( _arena->allocate( chunk_capacity() * sizeof( T ) ) ) );
+  }
+
+  arena *_arena;
+  std::vector<T*> _chunks;
+  std::size_t _size = 0u;
+  unsigned _log = 0u;
+  std::size_t _mask = 0u;
+}; // arena_vector
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
@@ -0,0 +1,353 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * concurrent_context                                                         *
+ ******************************************************************************/
+
+/* Hash-consing context that may be shared by several threads.
+ *
+ * Nodes are distributed over a power of two many shards by their structural
+ * hash.  Each shard owns a mutex, a strash_table, and an arena-backed node
+ * store; the id of a node is its position in the store of its shard times the
+ * number of shards plus the shard index, hence ids are globally unique and
+ * never change.  make_fun and make_symbol may be called concurrently; the
+ * accessors of a node may be called by any thread that obtained its id
+ * through some synchronization (e.g., a mutex-protected queue).  The chunk
+ * directories of the node stores are reserved up front, such that appending
+ * to a shard never moves the records that other threads read.
+ *
+ * Symbols are rare compared to nodes: they are interned under a mutex and
+ * published as an immutable snapshot, such that reading names and
+ * non-terminal flags takes no lock.  Rollback is not supported.
+ */
+class concurrent_context
+{
+public:
+  static constexpr bool thread_safe = true;
+
+  /* each shard has its own arena configured by `ps` */
+  explicit concurrent_context( unsigned num_shards = 64u, const arena_params& ps = default_shard_params() )
+  {
+    if ( num_shards == 0u || ( num_shards & ( num_shards - 1u ) ) != 0u || num_shards > ( 1u << 16u ) )
+    {
+      throw std::invalid_argument( "number of shards must be a power of two up to 2^16" );
+    }
+    while ( ( 1u << _shard_bits ) < num_shards )
+    {
+      ++_shard_bits;
+    }
+    _shard_mask = num_shards - 1u;
+
+    /* ids must fit into 32 bits */
+    _max_nodes_per_shard = ( std::size_t( 1u ) << ( 32u - _shard_bits ) ) - 1u;
+    for ( auto i = 0u; i < num_shards; ++i )
+    {
+      _shards.emplace_back( new shard( ps, _max_nodes_per_shard ) );
+    }
+
+    _snapshots.emplace_back( new symbol_snapshot );
+    _snapshot = _snapshots.back().get();
+  }
+
+  concurrent_context( const concurrent_context& ) = delete;
+  concurrent_context& operator=( const concurrent_context& ) = delete;
+
+  /* interns a function symbol without creating a node */
+  unsigned make_symbol( const std::string& name )
+  {
+    std::lock_guard<std::mutex> lock( _symbol_mutex );
+
+    const auto it = _symbol_ids.find( name );
+    if ( it != _symbol_ids.end() )
+    {
+      return it->second;
+    }
+
+    const auto id = unsigned( _symbol_names.size() );
+    _symbol_names.push_back( name );
+    _symbol_ids.emplace( name, id );
+
+    /* publish a copy of the snapshot that includes the new symbol */
+    std::unique_ptr<symbol_snapshot> next( new symbol_snapshot( *_snapshot.load() ) );
+    next->names.push_back( &_symbol_names.back() );
+    next->nonterminal.push_back( !name.empty() && name[0] == '_' );
+    _snapshots.push_back( std::move( next ) );
+    _snapshot.store( _snapshots.back().get(), std::memory_order_release );
+    return id;
+  }
+
+  unsigned make_fun( const std::string& name, const std::vector<unsigned>& children = {}, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( make_symbol( name ), children, attr );
+  }
+
+  unsigned make_fun( unsigned symbol, const std::vector<unsigned>& children = {}, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.data(), children.size(), attr );
+  }
+
+  unsigned make_fun( unsigned symbol, std::initializer_list<unsigned> children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.begin(), children.size(), attr );
+  }
+
+  unsigned make_fun( unsigned symbol, const expr_children& children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.begin(), children.size(), attr );
+  }
+
+  /* hash-conses a node; may be called concurrently */
+  unsigned make_fun( unsigned symbol, const unsigned *children, std::size_t num_children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    assert( attr <= 0xffff && num_children <= 0xffff );
+
+    const auto hash = expr_hash{}( symbol, children, num_children );
+    const auto s = unsigned( hash & _shard_mask );
+    auto& sh = *_shards[s];
+
+    std::lock_guard<std::mutex> lock( sh.mutex );
+    const auto local = sh.strash.find_or_insert( hash,
+      [&]( unsigned index ){
+        const auto& n = sh.nodes[ index ];
+        return n._symbol == symbol && n._arity == num_children &&
+          std::equal( children, children + num_children, children_of( sh, n ).begin() );
+      },
+      [&](){
+        const auto index = sh.nodes.size();
+        if ( index == _max_nodes_per_shard ||
+             ( num_children > expr_node::max_inline_children && sh.child_pool.size() + num_children > _max_nodes_per_shard ) )
+        {
+          throw std::length_error( "shard of concurrent_context is full" );
+        }
+
+        expr_node n;
+        n._symbol = symbol;
+        n._attr = attr;
+        n._arity = num_children;
+        if ( num_children <= expr_node::max_inline_children )
+        {
+          std::copy( children, children + num_children, n._children );
+        }
+        else
+        {
+          n._children[0u] = sh.child_pool.append( children, num_children );
+        }
+
+        sh.infos.push_back( compute_info( sh, n ) );
+        sh.nodes.push_back( n );
+        return unsigned( index );
+      },
+      [&]( unsigned index ){
+        const auto& n = sh.nodes[ index ];
+        return expr_hash{}( n._symbol, children_of( sh, n ).begin(), n._arity );
+      } );
+
+    return ( local << _shard_bits ) | s;
+  }
+
+  /* number of nodes */
+  std::size_t size() const
+  {
+    std::size_t total = 0u;
+    for ( const auto& sh : _shards )
+    {
+      std::lock_guard<std::mutex> lock( sh->mutex );
+      total += sh->nodes.size();
+    }
+    return total;
+  }
+
+  unsigned num_shards() const
+  {
+    return _shard_mask + 1u;
+  }
+
+  unsigned symbol( unsigned e ) const
+  {
+    return node( e )._symbol;
+  }
+
+  const std::string& name( unsigned e ) const
+  {
+    return *symbols().names[ node( e )._symbol ];
+  }
+
+  expr_attr attr( unsigned e ) const
+  {
+    return node( e )._attr;
+  }
+
+  expr_children children( unsigned e ) const
+  {
+    return children_of( *_shards[ e & _shard_mask ], node( e ) );
+  }
+
+  bool is_nonterminal( unsigned e ) const
+  {
+    return symbols().nonterminal[ node( e )._symbol ];
+  }
+
+  unsigned count_nonterminals( unsigned e ) const
+  {
+    return info( e )._num_nonterminals;
+  }
+
+  unsigned count_nodes( unsigned e ) const
+  {
+    return info( e )._num_nodes;
+  }
+
+  bool is_concrete( unsigned e ) const
+  {
+    return info( e )._num_nonterminals == 0u;
+  }
+
+  /* depth of the shallowest non-terminal, expr_info::no_path if concrete */
+  unsigned concretizable_depth( unsigned e ) const
+  {
+    return info( e )._path_depth;
+  }
+
+  /* child on the path to the shallowest non-terminal */
+  unsigned concretizable_child( unsigned e ) const
+  {
+    return info( e )._path_child;
+  }
+
+  bool has_flags( unsigned e, unsigned flags ) const
+  {
+    return ( info( e )._flags & flags ) != 0u;
+  }
+
+  /* bytes allocated for storing and hashing the nodes */
+  std::size_t memory_usage() const
+  {
+    std::size_t total = 0u;
+    for ( const auto& sh : _shards )
+    {
+      std::lock_guard<std::mutex> lock( sh->mutex );
+      total += sh->node_arena.memory_usage() + sh->strash.memory_usage();
+    }
+    return total;
+  }
+
+  /* smaller chunks than for a context, since there are many shards */
+  static arena_params default_shard_params()
+  {
+    arena_params ps;
+    ps.chunk_size = 1u << 16u;
+    return ps;
+  }
+
+private:
+  struct symbol_snapshot
+  {
+    std::vector<const std::string*> names;
+    std::vector<bool> nonterminal;
+  };
+
+  struct shard
+  {
+    shard( const arena_params& ps, std::size_t max_nodes )
+      : node_arena( ps )
+      , nodes( node_arena )
+      , infos( node_arena )
+      , child_pool( node_arena )
+      , strash( 64u )
+    {
+      nodes.reserve( max_nodes );
+      infos.reserve( max_nodes );
+      /* argument lists are appended chunk-wise, one chunk may be skipped per list */
+      child_pool.reserve( 2u * max_nodes );
+    }
+
+    mutable std::mutex mutex;
+    arena node_arena;
+    arena_vector<expr_node> nodes;
+    arena_vector<expr_info> infos;
+    arena_vector<unsigned> child_pool;
+    strash_table strash;
+  };
+
+  const symbol_snapshot& symbols() const
+  {
+    return *_snapshot.load( std::memory_order_acquire );
+  }
+
+  const expr_node& node( unsigned e ) const
+  {
+    return _shards[ e & _shard_mask ]->nodes[ e >> _shard_bits ];
+  }
+
+  const expr_info& info( unsigned e ) const
+  {
+    return _shards[ e & _shard_mask ]->infos[ e >> _shard_bits ];
+  }
+
+  static expr_children children_of( const shard& sh, const expr_node& n )
+  {
+    const auto *begin = n._arity <= expr_node::max_inline_children ? n._children : &sh.child_pool[ n._children[0u] ];
+    return expr_children( begin, begin + n._arity );
+  }
+
+  /* children may live in other shards */
+  expr_info compute_info( const shard& sh, const expr_node& n ) const
+  {
+    return compute_expr_info( n, children_of( sh, n ), symbols().nonterminal[ n._symbol ],
+                              [this]( unsigned e ) -> const expr_info& { return info( e ); },
+                              [this]( unsigned e ) -> const expr_node& { return node( e ); } );
+  }
+
+  unsigned _shard_bits = 0u;
+  unsigned _shard_mask = 0u;
+  std::size_t _max_nodes_per_shard = 0u;
+  std::vector<std::unique_ptr<shard>> _shards;
+
+  std::mutex _symbol_mutex;
+  std::unordered_map<std::string, unsigned> _symbol_ids;
+  std::deque<std::string> _symbol_names;
+  std::vector<std::unique_ptr<symbol_snapshot>> _snapshots;
+  std::atomic<const symbol_snapshot*> _snapshot{ nullptr };
+}; // concurrent_context
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
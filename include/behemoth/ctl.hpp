@@ -0,0 +1,471 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <behemoth/node_table.hpp>
+#include <behemoth/truth_table.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * kripke_structure                                                           *
+ ******************************************************************************/
+
+/* Explicit Kripke structure over at most 64 atomic propositions.
+ *
+ * Several structures can be checked at once by adding them as disjoint
+ * parts of one structure; a formula holds if it holds in all initial states.
+ * States without successors are deadlocks: EX is false and AX is true in
+ * them, and no infinite path passes through them.
+ */
+class kripke_structure
+{
+public:
+  explicit kripke_structure( unsigned num_vars )
+    : _num_vars( num_vars )
+  {
+    if ( num_vars > 64u )
+    {
+      throw std::invalid_argument( "Kripke structures support at most 64 variables" );
+    }
+  }
+
+  /* adds a state in which variable i holds iff bit i of `label` is set */
+  unsigned add_state( std::uint64_t label )
+  {
+    _labels.push_back( label );
+    _finalized = false;
+    return unsigned( _labels.size() - 1u );
+  }
+
+  void add_transition( unsigned from, unsigned to )
+  {
+    if ( from >= num_states() || to >= num_states() )
+    {
+      throw std::invalid_argument( "transition between unknown states" );
+    }
+    _transitions.emplace_back( from, to );
+    _finalized = false;
+  }
+
+  void add_initial_state( unsigned s )
+  {
+    if ( s >= num_states() )
+    {
+      throw std::invalid_argument( "unknown initial state" );
+    }
+    _initial.push_back( s );
+  }
+
+  /* builds the predecessor lists and the state sets of the variables */
+  void finalize()
+  {
+    if ( _finalized )
+    {
+      return;
+    }
+
+    const auto n = num_states();
+    std::sort( _transitions.begin(), _transitions.end() );
+    _transitions.erase( std::unique( _transitions.begin(), _transitions.end() ), _transitions.end() );
+
+    /* predecessors in compressed sparse row format */
+    _num_successors.assign( n, 0u );
+    _pred_offset.assign( n + 1u, 0u );
+    for ( const auto& t : _transitions )
+    {
+      ++_num_successors[t.first];
+      ++_pred_offset[t.second + 1u];
+    }
+    for ( auto s = 0u; s < n; ++s )
+    {
+      _pred_offset[s + 1u] += _pred_offset[s];
+    }
+    _predecessors.resize( _transitions.size() );
+    auto next = _pred_offset;
+    for ( const auto& t : _transitions )
+    {
+      _predecessors[next[t.second]++] = t.first;
+    }
+
+    _values.assign( std::size_t( _num_vars ) * num_words(), 0u );
+    _all.assign( num_words(), 0u );
+    for ( auto s = 0u; s < n; ++s )
+    {
+      for ( auto i = 0u; i < _num_vars; ++i )
+      {
+        if ( ( _labels[s] >> i ) & 1u )
+        {
+          _values[i * num_words() + s / 64u] |= UINT64_C( 1 ) << ( s % 64u );
+        }
+      }
+      _all[s / 64u] |= UINT64_C( 1 ) << ( s % 64u );
+    }
+
+    _finalized = true;
+  }
+
+  unsigned num_vars() const { return _num_vars; }
+  unsigned num_states() const { return unsigned( _labels.size() ); }
+  std::size_t num_words() const { return ( _labels.size() + 63u ) / 64u; }
+  const std::vector<unsigned>& initial_states() const { return _initial; }
+
+  /* the following require finalize() */
+
+  const unsigned *predecessors_begin( unsigned s ) const { return _predecessors.data() + _pred_offset[s]; }
+  const unsigned *predecessors_end( unsigned s ) const { return _predecessors.data() + _pred_offset[s + 1u]; }
+  unsigned num_successors( unsigned s ) const { return _num_successors[s]; }
+
+  /* states in which variable `var` holds */
+  const std::uint64_t *values( unsigned var ) const { return _values.data() + var * num_words(); }
+
+  /* all states */
+  const std::uint64_t *all() const { return _all.data(); }
+
+private:
+  unsigned _num_vars;
+  std::vector<std::uint64_t> _labels;
+  std::vector<std::pair<unsigned, unsigned>> _transitions;
+  std::vector<unsigned> _initial;
+
+  bool _finalized = false;
+  std::vector<unsigned> _num_successors;
+  std::vector<unsigned> _pred_offset;
+  std::vector<unsigned> _predecessors;
+  std::vector<std::uint64_t> _values;
+  std::vector<std::uint64_t> _all;
+}; // kripke_structure
+
+/******************************************************************************
+ * ctl_model_checker                                                          *
+ ******************************************************************************/
+
+/* CTL meaning of a function symbol */
+enum class ctl_op : std::uint8_t
+{
+  unknown,  /* not evaluable, e.g., non-terminals */
+  variable,
+  constant0,
+  constant1,
+  not_,
+  and_,
+  or_,
+  ex,
+  ax,
+  ef,
+  af,
+  eg,
+  ag,
+  eu,
+  au
+}; // ctl_op
+
+/* Computes the states of a Kripke structure that satisfy CTL formulae.
+ *
+ * State sets are dense bitsets.  EX is the image under the predecessor
+ * lists, EU, AU, and EG are computed by worklist fixpoints, and the
+ * remaining operators are reduced to these.  The structure must not change
+ * while the checker is used.
+ */
+class ctl_model_checker : public node_evaluator<ctl_model_checker, std::uint64_t, ctl_op>
+{
+  using base_t = node_evaluator<ctl_model_checker, std::uint64_t, ctl_op>;
+  friend base_t;
+
+public:
+  ctl_model_checker( const context& ctx, kripke_structure& kripke, simd_isa isa = detect_simd_isa(), const node_table_params& ps = {} )
+    : base_t( ctx, kripke.num_words(), ps )
+    , _kripke( kripke )
+    , _kernels( isa )
+  {
+    _kripke.finalize();
+  }
+
+  /* `symbol` denotes variable `index` of the structure */
+  void add_variable( unsigned symbol, unsigned index )
+  {
+    if ( index >= _kripke.num_vars() )
+    {
+      throw std::invalid_argument( "variable index out of range" );
+    }
+    set_meaning( symbol, symbol_meaning{ ctl_op::variable, index } );
+  }
+
+  /* evaluate( e ) returns the states that satisfy `e`, as
+   * kripke_structure::num_words() words */
+
+  /* whether `e` holds in all initial states */
+  bool holds( unsigned e )
+  {
+    const auto *r = evaluate( e );
+    if ( !r )
+    {
+      return false;
+    }
+    return std::all_of( _kripke.initial_states().begin(), _kripke.initial_states().end(),
+                        [r]( unsigned s ) { return contains( r, s ); } );
+  }
+
+private:
+  static bool contains( const std::uint64_t *set, unsigned s )
+  {
+    return ( set[s / 64u] >> ( s % 64u ) ) & 1u;
+  }
+
+  static void insert( std::uint64_t *set, unsigned s )
+  {
+    set[s / 64u] |= UINT64_C( 1 ) << ( s % 64u );
+  }
+
+  static unsigned lowest_bit( std::uint64_t bits )
+  {
+#ifdef __GNUC__
+    return unsigned( __builtin_ctzll( bits ) );
+#else
+    auto bit = 0u;
+    for ( ; !( bits & 1u ); bits >>= 1u )
+    {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  static void erase( std::uint64_t *set, unsigned s )
+  {
+    set[s / 64u] &= ~( UINT64_C( 1 ) << ( s % 64u ) );
+  }
+
+  bool accepts( ctl_op op, std::size_t num_children ) const
+  {
+    switch ( op )
+    {
+    case ctl_op::variable:
+    case ctl_op::constant0:
+    case ctl_op::constant1:
+      return num_children == 0u;
+    case ctl_op::and_:
+    case ctl_op::or_:
+    case ctl_op::eu:
+    case ctl_op::au:
+      return num_children == 2u;
+    default:
+      return num_children == 1u;
+    }
+  }
+
+  void compute( const symbol_meaning& m, std::uint64_t *out, const std::uint64_t * const *children, std::size_t )
+  {
+    const auto n = _kripke.num_words();
+    const auto *all = _kripke.all();
+
+    switch ( m.op )
+    {
+    case ctl_op::variable:
+      std::copy( _kripke.values( m.index ), _kripke.values( m.index ) + n, out );
+      break;
+    case ctl_op::constant0:
+      std::fill( out, out + n, UINT64_C( 0 ) );
+      break;
+    case ctl_op::constant1:
+      std::copy( all, all + n, out );
+      break;
+    case ctl_op::not_:
+      _kernels.xor_( out, children[0u], all, n );
+      break;
+    case ctl_op::and_:
+      _kernels.and_( out, children[0u], children[1u], n );
+      break;
+    case ctl_op::or_:
+      _kernels.or_( out, children[0u], children[1u], n );
+      break;
+    case ctl_op::ex:
+      ex( out, children[0u] );
+      break;
+    case ctl_op::ax:
+      /* AX a = !EX!a */
+      _kernels.xor_( scratch( n ), children[0u], all, n );
+      ex( out, _scratch.data() );
+      _kernels.xor_( out, out, all, n );
+      break;
+    case ctl_op::ef:
+      eu( out, all, children[0u] );
+      break;
+    case ctl_op::af:
+      au( out, all, children[0u] );
+      break;
+    case ctl_op::eg:
+      eg( out, children[0u] );
+      break;
+    case ctl_op::ag:
+      /* AG a = !EF!a */
+      _kernels.xor_( scratch( n ), children[0u], all, n );
+      eu( out, all, _scratch.data() );
+      _kernels.xor_( out, out, all, n );
+      break;
+    case ctl_op::eu:
+      eu( out, children[0u], children[1u] );
+      break;
+    case ctl_op::au:
+      au( out, children[0u], children[1u] );
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* EX a: predecessors of states in a */
+  void ex( std::uint64_t *out, const std::uint64_t *a ) const
+  {
+    std::fill( out, out + _kripke.num_words(), UINT64_C( 0 ) );
+    for_each_state( a, [&]( unsigned s ) {
+      std::for_each( _kripke.predecessors_begin( s ), _kripke.predecessors_end( s ), [&]( unsigned p ) { insert( out, p ); } );
+    } );
+  }
+
+  /* E[a U b]: backward reachability from b through a */
+  void eu( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b )
+  {
+    std::copy( b, b + _kripke.num_words(), out );
+    _worklist.clear();
+    for_each_state( b, [&]( unsigned s ) { _worklist.push_back( s ); } );
+
+    while ( !_worklist.empty() )
+    {
+      const auto s = _worklist.back();
+      _worklist.pop_back();
+      for ( auto p = _kripke.predecessors_begin( s ); p != _kripke.predecessors_end( s ); ++p )
+      {
+        if ( contains( a, *p ) && !contains( out, *p ) )
+        {
+          insert( out, *p );
+          _worklist.push_back( *p );
+        }
+      }
+    }
+  }
+
+  /* A[a U b]: a state in a joins once all of its successors have joined */
+  void au( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b )
+  {
+    std::copy( b, b + _kripke.num_words(), out );
+    _pending.resize( _kripke.num_states() );
+    for ( auto s = 0u; s < _kripke.num_states(); ++s )
+    {
+      _pending[s] = _kripke.num_successors( s );
+    }
+    _worklist.clear();
+    for_each_state( b, [&]( unsigned s ) { _worklist.push_back( s ); } );
+
+    while ( !_worklist.empty() )
+    {
+      const auto s = _worklist.back();
+      _worklist.pop_back();
+      for ( auto p = _kripke.predecessors_begin( s ); p != _kripke.predecessors_end( s ); ++p )
+      {
+        if ( --_pending[*p] == 0u && contains( a, *p ) && !contains( out, *p ) )
+        {
+          insert( out, *p );
+          _worklist.push_back( *p );
+        }
+      }
+    }
+  }
+
+  /* EG a: states in a are removed once none of their successors is left */
+  void eg( std::uint64_t *out, const std::uint64_t *a )
+  {
+    std::copy( a, a + _kripke.num_words(), out );
+    _pending.assign( _kripke.num_states(), 0u );
+    for_each_state( a, [&]( unsigned s ) {
+      std::for_each( _kripke.predecessors_begin( s ), _kripke.predecessors_end( s ), [&]( unsigned p ) { ++_pending[p]; } );
+    } );
+
+    _worklist.clear();
+    for_each_state( a, [&]( unsigned s ) {
+      if ( _pending[s] == 0u )
+      {
+        erase( out, s );
+        _worklist.push_back( s );
+      }
+    } );
+
+    while ( !_worklist.empty() )
+    {
+      const auto s = _worklist.back();
+      _worklist.pop_back();
+      for ( auto p = _kripke.predecessors_begin( s ); p != _kripke.predecessors_end( s ); ++p )
+      {
+        if ( contains( out, *p ) && --_pending[*p] == 0u )
+        {
+          erase( out, *p );
+          _worklist.push_back( *p );
+        }
+      }
+    }
+  }
+
+  template<typename Fn>
+  void for_each_state( const std::uint64_t *set, Fn&& fn ) const
+  {
+    for ( auto w = 0u; w < _kripke.num_words(); ++w )
+    {
+      for ( auto bits = set[w]; bits != 0u; bits &= bits - 1u )
+      {
+        fn( unsigned( w * 64u + lowest_bit( bits ) ) );
+      }
+    }
+  }
+
+  std::uint64_t *scratch( std::size_t n )
+  {
+    _scratch.resize( n );
+    return _scratch.data();
+  }
+
+  kripke_structure& _kripke;
+  truth_table_kernels _kernels;
+
+  /* scratch space of the fixpoints */
+  std::vector<unsigned> _worklist;
+  std::vector<unsigned> _pending;
+  std::vector<std::uint64_t> _scratch;
+}; // ctl_model_checker
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
@@ -0,0 +1,506 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/enumerator.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * expression serialization                                                   *
+ ******************************************************************************/
+
+/* Appends `e` in prefix order as (symbol, attribute, arity) triples.  Symbol
+ * ids are only meaningful to contexts that interned the same symbols in the
+ * same order, e.g., copies of one context in forked processes. */
+inline void serialize_expr( const context& ctx, unsigned e, std::vector<std::uint32_t>& out )
+{
+  const auto children = ctx.children( e );
+  out.push_back( ctx.symbol( e ) );
+  out.push_back( ctx.attr( e ) );
+  out.push_back( std::uint32_t( children.size() ) );
+  for ( const auto c : children )
+  {
+    serialize_expr( ctx, c, out );
+  }
+}
+
+/* hash-conses the expression at `pos` and advances `pos` past it */
+inline unsigned deserialize_expr( context& ctx, const std::vector<std::uint32_t>& in, std::size_t& pos )
+{
+  if ( pos + 3u > in.size() )
+  {
+    throw std::runtime_error( "truncated expression" );
+  }
+  const auto symbol = in[pos++];
+  const auto attr = in[pos++];
+  const auto arity = in[pos++];
+
+  std::vector<unsigned> children( arity );
+  for ( auto& c : children )
+  {
+    c = deserialize_expr( ctx, in, pos );
+  }
+  return ctx.make_fun( symbol, children.data(), children.size(), attr );
+}
+
+/******************************************************************************
+ * distributed_enumerator                                                     *
+ ******************************************************************************/
+
+/* Enumerator that partitions each cost layer over worker processes.
+ *
+ * run() forks `num_workers` processes that inherit a copy of the context,
+ * hence of the grammar, and talks to each of them over a UNIX socket pair.
+ * For every cost layer, the coordinator assigns each abstract expression of
+ * that cost to a worker by a hash of its serialization.  The workers refine
+ * their share, following refinements of the same cost locally, and return
+ * all concrete expressions and costlier abstract expressions.  The
+ * coordinator hash-conses the returned expressions into its own context,
+ * drops duplicates (per cost) and redundant expressions, and reports the
+ * concrete expressions by cost as in parallel_enumerator.
+ *
+ * Node ids differ between processes, hence workers only drop double
+ * applications; the id-based canonical order of commutative operands is
+ * checked by is_redundant_in_search_order in the coordinator, whose
+ * context holds the ids of all expressions.  POSIX only.
+ */
+class distributed_enumerator
+{
+public:
+  distributed_enumerator( context& ctx, const rules_t& rules, int max_cost, unsigned num_workers )
+    : ctx( ctx )
+    , rules( rules )
+    , index( rules )
+    , max_cost( max_cost )
+    , num_workers( std::max( 1u, num_workers ) )
+  {}
+
+  virtual ~distributed_enumerator()
+  {
+    shutdown();
+  }
+
+  distributed_enumerator( const distributed_enumerator& ) = delete;
+  distributed_enumerator& operator=( const distributed_enumerator& ) = delete;
+
+  void add_expression( unsigned e )
+  {
+    layer( _abstract, 0u ).push_back( e );
+  }
+
+  /* forks the workers and enumerates until all abstract expressions below
+   * the cost bound are refined or termination is signaled */
+  void run();
+
+  /* called by the coordinator for every returned expression */
+  virtual bool is_redundant_in_search_order( unsigned e ) const
+  {
+    return ctx.has_flags( e, expr_info_flags::_has_double_application | expr_info_flags::_has_idempotent_or_commutative );
+  }
+
+  virtual void on_concrete_expression( cexpr_t e )
+  {
+    (void)e;
+  }
+
+  void signal_termination()
+  {
+    quit_enumeration = true;
+  }
+
+  bool is_running() const
+  {
+    return !quit_enumeration;
+  }
+
+  /* expressions returned by more than one worker or more than once */
+  std::size_t num_duplicates() const
+  {
+    return _duplicates;
+  }
+
+protected:
+  context& ctx;
+  bool quit_enumeration = false;
+
+  rules_t rules;
+  rule_index index;
+  int max_cost;
+  unsigned num_workers;
+
+  unsigned current_costs = 0u;
+
+private:
+  using layers_t = std::vector<std::vector<unsigned>>;
+  using message_t = std::vector<std::uint32_t>;
+
+#ifdef MSG_NOSIGNAL
+  static constexpr int no_sigpipe = MSG_NOSIGNAL;
+#else
+  static constexpr int no_sigpipe = 0;
+#endif
+
+  /* cost of the request that stops a worker */
+  static constexpr std::uint32_t stop = 0xffffffffu;
+
+  static std::vector<unsigned>& layer( layers_t& layers, unsigned cost )
+  {
+    if ( cost >= layers.size() )
+    {
+      layers.resize( cost + 1u );
+    }
+    return layers[cost];
+  }
+
+  void spawn();
+  void shutdown();
+  void process_layer( unsigned cost );
+  void report_below( unsigned cost );
+  void add_result( unsigned e, unsigned cost );
+
+  /* worker process */
+  void serve( int fd );
+  void refine_share( unsigned cost, const message_t& request, message_t& response );
+
+  static void send_message( int fd, const message_t& message );
+  static bool receive_message( int fd, message_t& message );
+
+  std::vector<int> _sockets;
+  std::vector<pid_t> _pids;
+
+  layers_t _abstract;
+  layers_t _concrete;
+  std::vector<std::unordered_set<unsigned>> _seen; /* ids of returned expressions by cost */
+  std::size_t _duplicates = 0u;
+}; // distributed_enumerator
+
+inline void distributed_enumerator::run()
+{
+  spawn();
+
+  while ( is_running() )
+  {
+    auto cost = 0u;
+    while ( cost < _abstract.size() && _abstract[cost].empty() )
+    {
+      ++cost;
+    }
+
+    if ( cost == _abstract.size() || cost >= unsigned( max_cost ) )
+    {
+      report_below( unsigned( _concrete.size() ) );
+      if ( cost != _abstract.size() )
+      {
+        std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+      }
+      quit_enumeration = true;
+      break;
+    }
+
+    /* no layer below `cost` is left to produce concrete expressions */
+    report_below( cost );
+
+    if ( cost > current_costs )
+    {
+      std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+      current_costs = cost;
+    }
+
+    process_layer( cost );
+  }
+
+  shutdown();
+}
+
+inline void distributed_enumerator::spawn()
+{
+  /* buffered output would be written again by every child */
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush( nullptr );
+
+  for ( auto i = 0u; i < num_workers; ++i )
+  {
+    int fds[2];
+    if ( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) != 0 )
+    {
+      throw std::runtime_error( "cannot create socket pair" );
+    }
+
+    const auto pid = fork();
+    if ( pid < 0 )
+    {
+      throw std::runtime_error( "cannot fork worker process" );
+    }
+    if ( pid == 0 )
+    {
+      /* the sockets of the previously forked siblings are not needed */
+      for ( const auto fd : _sockets )
+      {
+        close( fd );
+      }
+      close( fds[0] );
+      serve( fds[1] );
+      _exit( 0 );
+    }
+
+    close( fds[1] );
+    _sockets.push_back( fds[0] );
+    _pids.push_back( pid );
+  }
+}
+
+inline void distributed_enumerator::shutdown()
+{
+  for ( const auto fd : _sockets )
+  {
+    try
+    {
+      send_message( fd, message_t{ std::uint32_t( stop ) } );
+    }
+    catch ( const std::runtime_error& )
+    {
+      /* the worker is gone already */
+    }
+    close( fd );
+  }
+  for ( const auto pid : _pids )
+  {
+    waitpid( pid, nullptr, 0 );
+  }
+  _sockets.clear();
+  _pids.clear();
+}
+
+inline void distributed_enumerator::process_layer( unsigned cost )
+{
+  /* this and later layers only return expressions of cost `cost` or more */
+  for ( auto c = 0u; c < std::min<std::size_t>( cost, _seen.size() ); ++c )
+  {
+    std::unordered_set<unsigned>().swap( _seen[c] );
+  }
+
+  /* partition by a hash of the serialization, which is the same in every process */
+  std::vector<message_t> requests( num_workers, message_t{ cost } );
+  message_t words;
+  for ( const auto e : _abstract[cost] )
+  {
+    words.clear();
+    serialize_expr( ctx, e, words );
+
+    std::uint64_t h = 0u;
+    for ( const auto w : words )
+    {
+      h = expr_hash::mix( h + UINT64_C( 0x9e3779b97f4a7c15 ) + w );
+    }
+    auto& request = requests[h % num_workers];
+    request.insert( request.end(), words.begin(), words.end() );
+  }
+  std::vector<unsigned>().swap( _abstract[cost] );
+
+  /* workers read their whole request before they reply */
+  for ( auto i = 0u; i < num_workers; ++i )
+  {
+    send_message( _sockets[i], requests[i] );
+  }
+
+  message_t response;
+  for ( auto i = 0u; i < num_workers; ++i )
+  {
+    if ( !receive_message( _sockets[i], response ) )
+    {
+      throw std::runtime_error( "worker process terminated unexpectedly" );
+    }
+
+    std::size_t pos = 0u;
+    while ( pos < response.size() )
+    {
+      const auto result_cost = response[pos++];
+      add_result( deserialize_expr( ctx, response, pos ), result_cost );
+    }
+  }
+}
+
+inline void distributed_enumerator::add_result( unsigned e, unsigned cost )
+{
+  if ( is_redundant_in_search_order( e ) ) return;
+
+  if ( cost >= _seen.size() )
+  {
+    _seen.resize( cost + 1u );
+  }
+  if ( !_seen[cost].insert( e ).second )
+  {
+    ++_duplicates;
+    return;
+  }
+
+  if ( is_concrete( ctx, e ) )
+  {
+    layer( _concrete, cost ).push_back( e );
+  }
+  else
+  {
+    layer( _abstract, cost ).push_back( e );
+  }
+}
+
+inline void distributed_enumerator::report_below( unsigned cost )
+{
+  for ( auto c = 0u; c < std::min<std::size_t>( cost, _concrete.size() ); ++c )
+  {
+    for ( const auto e : _concrete[c] )
+    {
+      if ( !is_running() ) return;
+      on_concrete_expression( { e, c } );
+    }
+    std::vector<unsigned>().swap( _concrete[c] );
+  }
+}
+
+inline void distributed_enumerator::serve( int fd )
+{
+  message_t request, response;
+  try
+  {
+    while ( receive_message( fd, request ) && !request.empty() && request[0] != stop )
+    {
+      response.clear();
+      refine_share( request[0], request, response );
+      send_message( fd, response );
+    }
+  }
+  catch ( ... )
+  {
+    /* closing the socket tells the coordinator */
+  }
+  close( fd );
+}
+
+inline void distributed_enumerator::refine_share( unsigned cost, const message_t& request, message_t& response )
+{
+  expr_refiner refiner( ctx );
+
+  std::vector<unsigned> stack;
+  std::size_t pos = 1u;
+  while ( pos < request.size() )
+  {
+    stack.push_back( deserialize_expr( ctx, request, pos ) );
+  }
+
+  while ( !stack.empty() )
+  {
+    const auto e = stack.back();
+    stack.pop_back();
+
+    auto p = get_path_to_concretizable_element( ctx, e );
+    refiner.refine( e, p, index, [&]( unsigned child, unsigned child_cost ){
+        /* the order of commutative operands depends on ids and is checked by the coordinator */
+        if ( ctx.has_flags( child, expr_info_flags::_has_double_application ) ) return;
+
+        if ( child_cost == 0u && !is_concrete( ctx, child ) )
+        {
+          stack.push_back( child );
+          return;
+        }
+
+        response.push_back( cost + child_cost );
+        serialize_expr( ctx, child, response );
+      } );
+  }
+}
+
+inline void distributed_enumerator::send_message( int fd, const message_t& message )
+{
+  const std::uint64_t size = message.size();
+  const auto write_all = [fd]( const void *data, std::size_t bytes ){
+    const auto *p = static_cast<const char*>( data );
+    while ( bytes > 0u )
+    {
+      /* a closed peer is reported as an error rather than SIGPIPE */
+      const auto n = ::send( fd, p, bytes, no_sigpipe );
+      if ( n < 0 && errno == EINTR ) continue;
+      if ( n <= 0 )
+      {
+        throw std::runtime_error( "cannot write to worker socket" );
+      }
+      p += n;
+      bytes -= std::size_t( n );
+    }
+  };
+  write_all( &size, sizeof( size ) );
+  write_all( message.data(), message.size() * sizeof( std::uint32_t ) );
+}
+
+/* returns false if the peer closed the socket */
+inline bool distributed_enumerator::receive_message( int fd, message_t& message )
+{
+  const auto read_all = [fd]( void *data, std::size_t bytes ){
+    auto *p = static_cast<char*>( data );
+    while ( bytes > 0u )
+    {
+      const auto n = read( fd, p, bytes );
+      if ( n < 0 && errno == EINTR ) continue;
+      if ( n <= 0 )
+      {
+        return false;
+      }
+      p += n;
+      bytes -= std::size_t( n );
+    }
+    return true;
+  };
+
+  std::uint64_t size;
+  if ( !read_all( &size, sizeof( size ) ) )
+  {
+    return false;
+  }
+  message.resize( size );
+  return read_all( message.data(), size * sizeof( std::uint32_t ) );
+}
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
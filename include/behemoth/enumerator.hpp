@@ -26,7 +26,7 @@
 #pragma once
 
 #include <behemoth/expr.hpp>
-#include <queue>
+#include <behemoth/frontier.hpp>
 #include <iostream>
 #include <cassert>
 #include <fmt/format.h>
@@ -43,37 +43,65 @@ struct rule_t
 
 using rules_t = std::vector<rule_t>;
 
-/* expression with associated cost */
-using cexpr_t = std::pair<unsigned,unsigned>;
-
-struct expr_greater_than
+/* rules grouped by the non-terminal they match, in their original order */
+class rule_index
 {
-  expr_greater_than( context& ctx )
-    : _ctx( ctx )
-  {}
-
-  bool operator()(const cexpr_t& a, const cexpr_t& b) const
+public:
+  struct entry
   {
-    /* higher costs means greater */
-    if ( a.second > b.second ) return true;
-    if ( a.second < b.second ) return false;
+    unsigned replace;
+    unsigned cost;
+  };
 
-    /* more non-terminals means greater */
-    if ( _ctx.count_nonterminals( a.first ) > _ctx.count_nonterminals( b.first ) ) return true;
-    if ( _ctx.count_nonterminals( a.first ) < _ctx.count_nonterminals( b.first ) ) return false;
+  explicit rule_index( const rules_t& rules )
+  {
+    for ( const auto& r : rules )
+    {
+      if ( r.match + 2u > _offsets.size() )
+      {
+        _offsets.resize( r.match + 2u, 0u );
+      }
+      ++_offsets[r.match + 1u];
+    }
+    for ( auto i = 1u; i < _offsets.size(); ++i )
+    {
+      _offsets[i] += _offsets[i - 1u];
+    }
 
-    /* more nodes means greater */
-    if ( _ctx.count_nodes( a.first ) > _ctx.count_nodes( b.first ) ) return true;
-    if ( _ctx.count_nodes( a.first ) < _ctx.count_nodes( b.first ) ) return false;
+    _entries.resize( rules.size() );
+    auto next = _offsets;
+    for ( const auto& r : rules )
+    {
+      _entries[next[r.match]++] = entry{ r.replace, r.cost };
+    }
+  }
 
-    return false;
+  /* rules matching `nonterminal` as [first, last) */
+  std::pair<const entry*, const entry*> matching( unsigned nonterminal ) const
+  {
+    if ( nonterminal + 1u >= _offsets.size() )
+    {
+      return { nullptr, nullptr };
+    }
+    return { _entries.data() + _offsets[nonterminal], _entries.data() + _offsets[nonterminal + 1u] };
   }
 
-  context& _ctx;
-}; // expr_greater_than
+private:
+  std::vector<entry> _entries;
+  std::vector<unsigned> _offsets;
+}; // rule_index
 
+/* Path from the root of an expression to one of its nodes.
+ *
+ * Up to `max_packed_size` child indices smaller than 4 are packed into a
+ * 64-bit word (two bits each, the first index in the lowest bits), such that
+ * copying and modifying typical paths does not allocate.  Longer paths or
+ * larger indices spill into a vector.
+ */
 struct path_t
 {
+  enum { max_packed_size = 32u, max_packed_index = 3u };
+
   path_t ( unsigned initial_depth = std::numeric_limits<unsigned>::max() )
     : depth( initial_depth )
   {}
@@ -86,28 +114,81 @@ struct path_t
   std::string as_string() const
   {
     std::string s = "[";
-    for ( auto i = 0u; i < indices.size(); ++i )
+    for ( auto i = 0u; i < size(); ++i )
     {
-      s += fmt::format( "%s", indices[indices.size()-1u-i] );
+      s += fmt::format( "{}", (*this)[i] );
     }
     s += "] ";
-    s += invalid() ? "∞" : ( fmt::format( "%d", depth ) );
+    s += invalid() ? "∞" : ( fmt::format( "{}", depth ) );
     return s;
   }
 
-  inline unsigned operator[]( std::size_t i )
+  inline unsigned operator[]( std::size_t i ) const
+  {
+    if ( _spilled )
+    {
+      return _spill[_spill.size()-1u-i];
+    }
+    return unsigned( ( _packed >> ( 2u * i ) ) & 3u );
+  }
+
+  inline std::size_t size() const
+  {
+    return _spilled ? _spill.size() : _size;
+  }
+
+  inline bool empty() const
   {
-    return indices[indices.size()-1u-i];
+    return size() == 0u;
   }
 
   inline void push_front( unsigned v )
   {
-    indices.push_back( v );
+    if ( !_spilled && ( v > max_packed_index || _size == max_packed_size ) )
+    {
+      spill();
+    }
+
+    if ( _spilled )
+    {
+      _spill.push_back( v );
+    }
+    else
+    {
+      _packed = ( _packed << 2u ) | v;
+      ++_size;
+    }
+  }
+
+  inline void push_back( unsigned v )
+  {
+    if ( !_spilled && ( v > max_packed_index || _size == max_packed_size ) )
+    {
+      spill();
+    }
+
+    if ( _spilled )
+    {
+      _spill.insert( _spill.begin(), v );
+    }
+    else
+    {
+      _packed |= std::uint64_t( v ) << ( 2u * _size );
+      ++_size;
+    }
   }
 
   inline void pop_front()
   {
-    indices.pop_back();
+    if ( _spilled )
+    {
+      _spill.pop_back();
+    }
+    else
+    {
+      _packed >>= 2u;
+      --_size;
+    }
   }
 
   inline void incr_depth()
@@ -117,7 +198,7 @@ struct path_t
 
   inline bool invalid() const
   {
-    return indices.empty() && depth == std::numeric_limits<unsigned>::max();
+    return empty() && depth == std::numeric_limits<unsigned>::max();
   }
 
   inline bool valid() const
@@ -125,14 +206,30 @@ struct path_t
     return !invalid();
   }
 
-  /* indices in reverse order */
-  std::vector<unsigned> indices;
   unsigned depth;
+
+private:
+  void spill()
+  {
+    _spill.reserve( 2u * max_packed_size );
+    for ( auto i = _size; i-- > 0u; )
+    {
+      _spill.push_back( unsigned( ( _packed >> ( 2u * i ) ) & 3u ) );
+    }
+    _spilled = true;
+  }
+
+  std::uint64_t _packed = 0u;
+  unsigned _size = 0u;
+  bool _spilled = false;
+
+  /* indices in reverse order, once the path no longer fits the word */
+  std::vector<unsigned> _spill;
 }; // path_t
 
 std::vector<std::pair<unsigned,unsigned>> refine_expression_recurse( context& ctx, unsigned e, path_t path, const rules_t& rules )
 {
-  if ( path.indices.size() == 0u )
+  if ( path.empty() )
   {
     /* apply all rules */
     std::vector<std::pair<unsigned,unsigned>> results;
@@ -149,109 +246,234 @@ std::vector<std::pair<unsigned,unsigned>> refine_expression_recurse( context& ct
   auto index = path[ 0u ];
   path.pop_front();
 
-  auto candidates = refine_expression_recurse( ctx, ctx._exprs[ e ]._children[ index ], path, rules );
+  auto candidates = refine_expression_recurse( ctx, ctx.children( e )[ index ], path, rules );
 
   std::vector<std::pair<unsigned,unsigned>> results;
+  results.reserve( candidates.size() );
+
+  const auto children = ctx.children( e );
+  std::vector<unsigned> new_children( children.begin(), children.end() );
   for ( const auto& c : candidates )
   {
-    std::vector<unsigned> new_children;
+    /* add new instantiation */
+    new_children[ index ] = c.first;
 
-    /* copy the children before index */
-    for ( auto i = 0u; i < index; ++i )
-    {
-      new_children.push_back( ctx._exprs[ e ]._children[ i ] );
-    }
+    results.push_back( {ctx.make_fun( ctx.symbol( e ), new_children, ctx.attr( e ) ), c.second} );
+  }
 
-    /* add new instantiation */
-    new_children.push_back( c.first );
+  return results;
+}
 
-    /* copy the children after index */
-    for ( auto i = index+1; i < ctx._exprs[ e ]._children.size(); ++i )
-    {
-      new_children.push_back( ctx._exprs[ e ]._children[ i ] );
-    }
+template<typename Context>
+path_t get_path_to_concretizable_element( Context& ctx, unsigned e )
+{
+  const auto depth = ctx.concretizable_depth( e );
+  if ( depth == expr_info::no_path )
+  {
+    return path_t( std::numeric_limits<unsigned>::max() );
+  }
 
-    results.push_back( {ctx.make_fun( ctx._exprs[ e ]._name, new_children, ctx._exprs[ e ]._attr ), c.second} );
+  /* follow the cached child indices from the root */
+  path_t path( depth );
+  for ( auto i = 0u; i < depth; ++i )
+  {
+    path.push_back( ctx.concretizable_child( e ) );
+    e = ctx.children( e )[ ctx.concretizable_child( e ) ];
   }
 
-  return results;
+  return path;
 }
 
-path_t get_path_to_concretizable_element( context& ctx, unsigned e )
+template<typename Context>
+bool is_concrete( Context& ctx, unsigned e )
+{
+  return ctx.is_concrete( e );
+}
+
+/* Iterative refinement along a path.
+ *
+ * The path is walked once to record the spine of nodes from the root to the
+ * non-terminal, copying their children into one scratch buffer that is
+ * reused across calls.  For every rule that applies to the non-terminal, the
+ * spine is rebuilt bottom-up by substituting one child per level in the
+ * buffer, and the resulting expression is passed to a callback together with
+ * the cost of the rule.  Results are produced in the same order as by
+ * refine_expression_recurse.  `Context` is context or concurrent_context.
+ */
+template<typename Context>
+class basic_expr_refiner
 {
-  /* non-terminal */
-  if ( ctx._exprs[ e ]._name[0] == '_' )
+public:
+  explicit basic_expr_refiner( Context& ctx )
+    : _ctx( ctx )
+  {}
+
+  template<typename Fn>
+  void refine( unsigned e, const path_t& path, const rules_t& rules, Fn&& fn )
   {
-    return path_t( 0u );
+    e = walk( e, path );
+    for ( const auto& r : rules )
+    {
+      if ( e == r.match )
+      {
+        fn( rebuild( r.replace ), r.cost );
+      }
+    }
   }
 
-  /* variable or constant */
-  if ( ctx._exprs[ e ]._children.size() == 0u )
+  template<typename Fn>
+  void refine( unsigned e, const path_t& path, const rule_index& index, Fn&& fn )
   {
-    return path_t( std::numeric_limits<unsigned>::max() );
+    const auto nonterminal = walk( e, path );
+    const auto range = index.matching( nonterminal );
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+      fn( rebuild( it->replace ), it->cost );
+    }
   }
 
-  /* others */
-  path_t min_path;
-  min_path.depth = std::numeric_limits<unsigned>::max();
-  for ( auto i = 0u; i < ctx._exprs[e]._children.size(); ++i )
+private:
+  struct spine_entry
+  {
+    unsigned symbol;
+    expr_attr attr;
+    unsigned first_child; /* offset of the children in _scratch */
+    unsigned num_children;
+    unsigned replaced;    /* offset of the child on the path */
+  };
+
+  /* records the spine and returns the node at the end of the path */
+  unsigned walk( unsigned e, const path_t& path )
   {
-    auto path = get_path_to_concretizable_element( ctx, ctx._exprs[e]._children[ i ] );
-    if ( path < min_path )
+    _spine.clear();
+    _scratch.clear();
+    for ( auto i = 0u; i < path.size(); ++i )
     {
-      auto new_path = path;
-      new_path.push_front( i );
-      min_path = new_path;
+      const auto children = _ctx.children( e );
+      _spine.push_back( spine_entry{ _ctx.symbol( e ), _ctx.attr( e ), unsigned( _scratch.size() ), unsigned( children.size() ), unsigned( _scratch.size() + path[ i ] ) } );
+      _scratch.insert( _scratch.end(), children.begin(), children.end() );
+      e = children[ path[ i ] ];
     }
+    return e;
   }
 
-  if ( min_path < std::numeric_limits<unsigned>::max() )
+  unsigned rebuild( unsigned e )
   {
-    min_path.incr_depth();
+    for ( auto i = _spine.size(); i-- > 0u; )
+    {
+      const auto& s = _spine[ i ];
+      _scratch[ s.replaced ] = e;
+      e = _ctx.make_fun( s.symbol, _scratch.data() + s.first_child, s.num_children, s.attr );
+    }
+    return e;
   }
 
-  return min_path;
-}
+  Context& _ctx;
+  std::vector<spine_entry> _spine;
+  std::vector<unsigned> _scratch;
+}; // basic_expr_refiner
 
-bool is_concrete( context& ctx, unsigned e )
-{
-  return get_path_to_concretizable_element( ctx, e ).invalid();
-}
+using expr_refiner = basic_expr_refiner<context>;
 
-class enumerator
+/* Enumerates expressions in the order in which the `Frontier` policy (see
+ * frontier.hpp) returns abstract expressions for refinement.
+ *
+ * The hooks (on_expression, on_concrete_expression, on_abstract_expression,
+ * their batch versions, and is_redundant_in_search_order) are resolved
+ * statically on `Derived`, which may redefine any of them without `virtual`
+ * such that they are inlined into the refinement loop.  basic_enumerator
+ * derives from this class and makes the hooks virtual.
+ */
+template<typename Derived, typename Frontier = heap_frontier>
+class static_enumerator
 {
 public:
-  using expr_queue_t = std::priority_queue<cexpr_t, std::vector<cexpr_t>, expr_greater_than>;
+  using expr_queue_t = Frontier;
 
 public:
-  enumerator( context& ctx, const rules_t& rules, int max_cost )
+  static_enumerator( context& ctx, const rules_t& rules, int max_cost )
     : ctx( ctx )
     , rules( rules )
+    , index( rules )
     , max_cost( max_cost )
-    , candidate_expressions( ctx ) /* pass ctx to the expr_greater_than */
+    , candidate_expressions( ctx )
+    , refiner( ctx )
   {}
 
-  virtual ~enumerator() {}
+  /* takes a configured frontier, e.g., a beam_frontier of a given width */
+  static_enumerator( context& ctx, const rules_t& rules, int max_cost, Frontier frontier )
+    : ctx( ctx )
+    , rules( rules )
+    , index( rules )
+    , max_cost( max_cost )
+    , candidate_expressions( std::move( frontier ) )
+    , refiner( ctx )
+  {}
 
   void add_expression( unsigned e );
   void deduce( unsigned number_of_steps = 1u );
 
-  virtual bool is_redundant_in_search_order( unsigned e ) const;
+  /* Pops up to `max_candidates` candidates of the same cost, refines all of
+   * them, and then passes the non-redundant refinements to on_expressions
+   * and the concrete ones among them to on_concrete_expressions, each as one
+   * contiguous batch in the order in which deduce would have produced them.
+   * Abstract refinements are passed to on_abstract_expression after the
+   * batch callbacks.  In iterative deepening mode, this is deduce. */
+  void deduce_batch( unsigned max_candidates = 1024u );
+
+  /* Switches to iterative deepening on cost; call before add_expression.
+   *
+   * Instead of keeping all abstract expressions in the frontier, the
+   * expressions are re-enumerated depth-first for every cost bound 0, 1,
+   * 2, ..., and only the concrete expressions of exactly the current bound
+   * are reported.  Concrete expressions are thus reported in nondecreasing
+   * cost order, and memory is limited to the expressions along the current
+   * refinement path and their siblings, at the price of refining cheap
+   * expressions once per bound.  on_expression and on_concrete_expression
+   * are called once per expression; on_abstract_expression is not called.
+   */
+  void use_iterative_deepening()
+  {
+    assert( candidate_expressions.empty() && roots.empty() );
+    iterative_deepening = true;
+  }
+
+  bool is_redundant_in_search_order( unsigned e ) const;
 
   inline bool check_double_application( unsigned e ) const;
   inline bool check_idempotence_and_commutative( unsigned e ) const;
 
-  virtual void on_expression( cexpr_t e )
+  void on_expression( cexpr_t e )
   {
     (void)e;
   }
 
-  virtual void on_concrete_expression( cexpr_t e )
+  void on_concrete_expression( cexpr_t e )
   {
     (void)e;
   }
 
-  virtual void on_abstract_expression( cexpr_t e )
+  /* batch callbacks of deduce_batch; by default forward to the callbacks
+   * above until the enumeration is terminated */
+  void on_expressions( cexpr_span batch )
+  {
+    for ( const auto& e : batch )
+    {
+      if ( !is_running() ) return;
+      derived().on_expression( e );
+    }
+  }
+
+  void on_concrete_expressions( cexpr_span batch )
+  {
+    for ( const auto& e : batch )
+    {
+      if ( !is_running() ) return;
+      derived().on_concrete_expression( e );
+    }
+  }
+
+  void on_abstract_expression( cexpr_t e )
   {
     candidate_expressions.push( e );
   }
@@ -267,23 +489,103 @@ public:
   }
 
 protected:
+  Derived& derived() { return static_cast<Derived&>( *this ); }
+  const Derived& derived() const { return static_cast<const Derived&>( *this ); }
+
   context& ctx;
   bool quit_enumeration = false;
 
   rules_t rules;
+  rule_index index;
   int max_cost;
   expr_queue_t candidate_expressions;
+  expr_refiner refiner;
 
   unsigned current_costs = 0u;
-};
 
-void enumerator::add_expression( unsigned e )
+  /* iterative deepening */
+  void deepen( unsigned number_of_steps );
+
+  bool iterative_deepening = false;
+  std::vector<unsigned> roots;
+  std::vector<cexpr_t> stack;
+  bool bound_exceeded = false;
+
+  /* buffers of deduce_batch */
+  std::vector<unsigned> block;
+  std::vector<cexpr_t> batch;
+  std::vector<cexpr_t> concrete_batch;
+}; // static_enumerator
+
+/* static_enumerator with virtual hooks */
+template<typename Frontier>
+class basic_enumerator : public static_enumerator<basic_enumerator<Frontier>, Frontier>
 {
+  using base_t = static_enumerator<basic_enumerator<Frontier>, Frontier>;
+
+public:
+  using base_t::base_t;
+
+  virtual ~basic_enumerator() {}
+
+  virtual bool is_redundant_in_search_order( unsigned e ) const
+  {
+    return base_t::is_redundant_in_search_order( e );
+  }
+
+  virtual void on_expression( cexpr_t e )
+  {
+    base_t::on_expression( e );
+  }
+
+  virtual void on_concrete_expression( cexpr_t e )
+  {
+    base_t::on_concrete_expression( e );
+  }
+
+  virtual void on_expressions( cexpr_span batch )
+  {
+    base_t::on_expressions( batch );
+  }
+
+  virtual void on_concrete_expressions( cexpr_span batch )
+  {
+    base_t::on_concrete_expressions( batch );
+  }
+
+  virtual void on_abstract_expression( cexpr_t e )
+  {
+    base_t::on_abstract_expression( e );
+  }
+}; // basic_enumerator
+
+class enumerator : public basic_enumerator<heap_frontier>
+{
+public:
+  using basic_enumerator::basic_enumerator;
+}; // enumerator
+
+template<typename Derived, typename Frontier>
+void static_enumerator<Derived, Frontier>::add_expression( unsigned e )
+{
+  if ( iterative_deepening )
+  {
+    roots.push_back( e );
+    stack.push_back( { e, 0u } );
+    return;
+  }
   candidate_expressions.push( { e, 0u } );
 }
 
-void enumerator::deduce( unsigned number_of_steps )
+template<typename Derived, typename Frontier>
+void static_enumerator<Derived, Frontier>::deduce( unsigned number_of_steps )
 {
+  if ( iterative_deepening )
+  {
+    deepen( number_of_steps );
+    return;
+  }
+
   for ( auto i = 0u; i < number_of_steps; ++i )
   {
     if ( candidate_expressions.empty() )
@@ -296,104 +598,208 @@ void enumerator::deduce( unsigned number_of_steps )
     auto next_candidate = candidate_expressions.top();
     candidate_expressions.pop();
 
-    if ( next_candidate.second > current_costs )
+    if ( Frontier::cost_ordered && next_candidate.second > current_costs )
     {
       std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
       current_costs = next_candidate.second;
     }
 
-    if ( next_candidate.second >= max_cost )
+    if ( next_candidate.second >= unsigned( max_cost ) )
     {
-      quit_enumeration = true;
+      /* all remaining candidates exceed the bound if the frontier is ordered by cost */
+      if ( Frontier::cost_ordered )
+      {
+        quit_enumeration = true;
+      }
       continue;
     }
 
     auto p = get_path_to_concretizable_element( ctx, next_candidate.first );
-    auto new_candidates = refine_expression_recurse( ctx, next_candidate.first, p, rules );
-    for ( const auto& c : new_candidates )
-    {
-      if ( !is_running() ) break;
-      if ( is_redundant_in_search_order( c.first ) ) continue;
-
-      auto cc = cexpr_t{ c.first, next_candidate.second + c.second };
-      on_expression( cc );
-
-      if ( is_concrete( ctx, c.first ) )
-      {
-        on_concrete_expression(cc);
-      }
-      else
-      {
-        on_abstract_expression(cc);
-      }
-    }
+    refiner.refine( next_candidate.first, p, index, [&]( unsigned e, unsigned cost ){
+        if ( !is_running() ) return;
+        if ( derived().is_redundant_in_search_order( e ) ) return;
+
+        auto cc = cexpr_t{ e, next_candidate.second + cost };
+        derived().on_expression( cc );
+
+        if ( is_concrete( ctx, e ) )
+        {
+          derived().on_concrete_expression(cc);
+        }
+        else
+        {
+          derived().on_abstract_expression(cc);
+        }
+      } );
   }
 }
 
-bool enumerator::check_double_application( unsigned e ) const
+template<typename Derived, typename Frontier>
+void static_enumerator<Derived, Frontier>::deduce_batch( unsigned max_candidates )
 {
-  const auto expr = ctx._exprs[ e ];
+  if ( iterative_deepening )
+  {
+    deepen( max_candidates );
+    return;
+  }
 
-  /* no double-negation */
-  if ( expr._name[0] != '_' && (expr._attr & expr_attr_enum::_no_double_application) == expr_attr_enum::_no_double_application )
+  if ( candidate_expressions.empty() )
   {
-    assert( expr._children.size() == 1u );
-    const auto child0 = ctx._exprs[ expr._children[0u] ];
-    if ( child0._name == expr._name && child0._attr == expr_attr_enum::_no_double_application )
-    {
-      return true;
-    }
+    quit_enumeration = true;
   }
 
-  for ( const auto& c : expr._children )
+  if ( !is_running() ) { return; }
+
+  const auto cost = candidate_expressions.top().second;
+  if ( Frontier::cost_ordered && cost > current_costs )
   {
-    if ( check_double_application( c ) )
-    {
-      return true;
-    }
+    std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+    current_costs = cost;
   }
 
-  return false;
-}
+  if ( cost >= unsigned( max_cost ) && Frontier::cost_ordered )
+  {
+    quit_enumeration = true;
+    return;
+  }
 
-bool enumerator::check_idempotence_and_commutative( unsigned e ) const
-{
-  const auto is_set = []( unsigned value, unsigned flag ) { return ( ( value & flag ) == flag ); };
+  block.clear();
+  while ( block.size() < max_candidates && !candidate_expressions.empty() && candidate_expressions.top().second == cost )
+  {
+    block.push_back( candidate_expressions.top().first );
+    candidate_expressions.pop();
+  }
 
-  const auto expr = ctx._exprs[ e ];
-  if ( expr._name[0] != '_' && expr._children.size() == 2u &&
-       (ctx.count_nonterminals( expr._children[0u] ) == 0) &&
-       (ctx.count_nonterminals( expr._children[1u] ) == 0) )
+  if ( cost >= unsigned( max_cost ) )
   {
-    if ( is_set( expr._attr, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) &&
-         expr._children[0u] >= expr._children[1u] )
-    {
-      return true;
-    }
-    else if ( is_set( expr._attr, expr_attr_enum::_commutative ) &&
-              expr._children[0u] > expr._children[1u] )
-    {
-      return true;
-    }
-    else if ( is_set( expr._attr, expr_attr_enum::_idempotent ) &&
-              expr._children[0u] == expr._children[1u] )
+    return;
+  }
+
+  batch.clear();
+  concrete_batch.clear();
+  std::size_t num_abstract = 0u;
+  for ( const auto e : block )
+  {
+    if ( !is_running() ) { return; }
+
+    auto p = get_path_to_concretizable_element( ctx, e );
+    refiner.refine( e, p, index, [&]( unsigned child, unsigned child_cost ){
+        if ( !is_running() ) return;
+        if ( derived().is_redundant_in_search_order( child ) ) return;
+
+        const auto cc = cexpr_t{ child, cost + child_cost };
+        batch.push_back( cc );
+        if ( is_concrete( ctx, child ) )
+        {
+          concrete_batch.push_back( cc );
+        }
+        else
+        {
+          ++num_abstract;
+        }
+      } );
+  }
+
+  derived().on_expressions( cexpr_span( batch.data(), batch.data() + batch.size() ) );
+  if ( !concrete_batch.empty() && is_running() )
+  {
+    derived().on_concrete_expressions( cexpr_span( concrete_batch.data(), concrete_batch.data() + concrete_batch.size() ) );
+  }
+
+  if ( num_abstract > 0u && is_running() )
+  {
+    for ( const auto& cc : batch )
     {
-      return true;
+      if ( !is_concrete( ctx, cc.first ) )
+      {
+        derived().on_abstract_expression( cc );
+      }
     }
   }
+}
 
-  for ( const auto& c : expr._children )
+template<typename Derived, typename Frontier>
+void static_enumerator<Derived, Frontier>::deepen( unsigned number_of_steps )
+{
+  for ( auto i = 0u; i < number_of_steps; ++i )
   {
-    if ( check_idempotence_and_commutative( c ) )
+    if ( stack.empty() )
+    {
+      /* the next bound is only needed if the current one pruned something */
+      if ( !bound_exceeded )
+      {
+        quit_enumeration = true;
+      }
+      else
+      {
+        std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+        ++current_costs;
+        bound_exceeded = false;
+        for ( auto it = roots.rbegin(); it != roots.rend(); ++it )
+        {
+          stack.push_back( { *it, 0u } );
+        }
+      }
+    }
+
+    if ( !is_running() ) { return; }
+
+    const auto next_candidate = stack.back();
+    stack.pop_back();
+
+    if ( next_candidate.second >= unsigned( max_cost ) )
     {
-      return true;
+      continue;
     }
+
+    auto p = get_path_to_concretizable_element( ctx, next_candidate.first );
+    refiner.refine( next_candidate.first, p, index, [&]( unsigned e, unsigned cost ){
+        if ( !is_running() ) return;
+
+        if ( derived().is_redundant_in_search_order( e ) ) return;
+
+        auto cc = cexpr_t{ e, next_candidate.second + cost };
+        if ( cc.second > current_costs )
+        {
+          bound_exceeded = true;
+          return;
+        }
+
+        /* expressions below the bound have been reported for an earlier bound */
+        if ( cc.second == current_costs )
+        {
+          derived().on_expression( cc );
+        }
+
+        if ( is_concrete( ctx, e ) )
+        {
+          if ( cc.second == current_costs )
+          {
+            derived().on_concrete_expression( cc );
+          }
+        }
+        else
+        {
+          stack.push_back( cc );
+        }
+      } );
   }
+}
 
-  return false;
+template<typename Derived, typename Frontier>
+bool static_enumerator<Derived, Frontier>::check_double_application( unsigned e ) const
+{
+  return ctx.has_flags( e, expr_info_flags::_has_double_application );
+}
+
+template<typename Derived, typename Frontier>
+bool static_enumerator<Derived, Frontier>::check_idempotence_and_commutative( unsigned e ) const
+{
+  return ctx.has_flags( e, expr_info_flags::_has_idempotent_or_commutative );
 }
 
-bool enumerator::is_redundant_in_search_order( unsigned e ) const
+template<typename Derived, typename Frontier>
+bool static_enumerator<Derived, Frontier>::is_redundant_in_search_order( unsigned e ) const
 {
   if ( check_double_application( e ) )
   {
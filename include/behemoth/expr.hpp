@@ -29,6 +29,14 @@
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <initializer_list>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <behemoth/arena.hpp>
+#include <behemoth/strash.hpp>
 
 namespace behemoth
 {
@@ -47,135 +55,473 @@ enum expr_attr_enum
 
 using expr_attr = unsigned;
 
+/******************************************************************************
+ * symbol_table                                                               *
+ ******************************************************************************/
+
+/* interns function symbols to small integer ids */
+class symbol_table
+{
+public:
+  unsigned intern( const std::string& name )
+  {
+    const auto it = _ids.find( name );
+    if ( it != _ids.end() )
+    {
+      return it->second;
+    }
+
+    const auto id = unsigned( _names.size() );
+    _names.push_back( name );
+    _nonterminal.push_back( !name.empty() && name[0] == '_' );
+    _ids.emplace( name, id );
+    return id;
+  }
+
+  const std::string& name( unsigned id ) const
+  {
+    return _names[ id ];
+  }
+
+  /* symbols starting with an underscore are non-terminals */
+  bool is_nonterminal( unsigned id ) const
+  {
+    return _nonterminal[ id ];
+  }
+
+  std::size_t size() const
+  {
+    return _names.size();
+  }
+
+private:
+  std::vector<std::string> _names;
+  std::vector<bool> _nonterminal;
+  std::unordered_map<std::string, unsigned> _ids;
+}; // symbol_table
+
 /******************************************************************************
  * expr_node                                                                  *
  ******************************************************************************/
 
+/* compact node record: up to `max_inline_children` children are stored
+ * inline, larger argument lists live in the child pool of the context and
+ * `_children[0]` holds their offset */
 struct expr_node
 {
-  expr_node( std::string name, const std::vector<unsigned>& children, const expr_attr attr = expr_attr_enum::_no )
-    : _name( name )
-    , _children( children )
-    , _attr( attr )
+  enum { max_inline_children = 3u };
+
+  unsigned _symbol;
+  std::uint16_t _attr;
+  std::uint16_t _arity;
+  unsigned _children[max_inline_children];
+}; // expr_node
+
+/* read-only view on the children of a node */
+class expr_children
+{
+public:
+  expr_children( const unsigned *begin, const unsigned *end )
+    : _begin( begin )
+    , _end( end )
   {}
 
-  bool operator==( const expr_node& e ) const
+  const unsigned *begin() const { return _begin; }
+  const unsigned *end() const { return _end; }
+  std::size_t size() const { return _end - _begin; }
+  bool empty() const { return _begin == _end; }
+  unsigned operator[]( std::size_t i ) const { return _begin[ i ]; }
+
+private:
+  const unsigned *_begin;
+  const unsigned *_end;
+}; // expr_children
+
+/* Hash of a hash-consed node.  Children are dense small integers, hence every
+ * word is mixed by a multiply-xorshift step (the finalizer of SplitMix64),
+ * such that each input bit affects all bits of the result. */
+struct expr_hash
+{
+  static std::uint64_t mix( std::uint64_t x )
   {
-    if ( _name != e._name ) return false;
-    if ( _children.size() != e._children.size() ) return false;
-    for ( auto i = 0; i < _children.size(); ++i )
+    x ^= x >> 30;
+    x *= UINT64_C( 0xbf58476d1ce4e5b9 );
+    x ^= x >> 27;
+    x *= UINT64_C( 0x94d049bb133111eb );
+    x ^= x >> 31;
+    return x;
+  }
+
+  std::size_t operator()( unsigned symbol, const unsigned *children, std::size_t num_children ) const
+  {
+    std::uint64_t seed = mix( ( std::uint64_t( num_children ) << 32u ) | symbol );
+    for ( auto i = 0u; i < num_children; ++i )
     {
-      if ( _children[i] != e._children[i] )
-      {
-        return false;
-      }
+      seed = mix( seed + UINT64_C( 0x9e3779b97f4a7c15 ) + children[i] );
     }
-    return true;
+    return std::size_t( seed );
   }
+}; // expr_hash
 
-  std::string _name;
-  std::vector<unsigned> _children;
-  expr_attr _attr;
-}; // expr_node
+/******************************************************************************
+ * expr_info                                                                  *
+ ******************************************************************************/
 
-struct expr_hash : public std::unary_function<expr_node, std::size_t>
+enum expr_info_flags
 {
-  std::size_t operator()(const expr_node& e) const
+  _has_double_application = 1,      /* violates _no_double_application */
+  _has_idempotent_or_commutative = 1 << 1 /* violates _idempotent or _commutative */
+}; // expr_info_flags
+
+/* metadata of a node, computed once from the children when it is created */
+struct expr_info
+{
+  unsigned _num_nodes;
+  unsigned _num_nonterminals;
+
+  /* depth of the shallowest (leftmost) non-terminal and the child on the
+   * path to it; the depth is `no_path` for concrete expressions */
+  unsigned _path_depth;
+  std::uint16_t _path_child;
+
+  std::uint16_t _flags;
+
+  static constexpr unsigned no_path = std::numeric_limits<unsigned>::max();
+}; // expr_info
+
+/* Computes the metadata of node `n` from the metadata of its children;
+ * `info_of` and `node_of` return the records of a child id. */
+template<typename InfoOf, typename NodeOf>
+expr_info compute_expr_info( const expr_node& n, const expr_children& children, bool nonterminal, InfoOf&& info_of, NodeOf&& node_of )
+{
+  const auto is_set = []( unsigned value, unsigned flag ) { return ( ( value & flag ) == flag ); };
+
+  expr_info info{ 1u, 0u, expr_info::no_path, 0u, 0u };
+  for ( auto i = 0u; i < children.size(); ++i )
   {
-    auto seed = std::hash<std::string>{}( e._name );
-    for ( const auto& u : e._children )
+    const auto& ci = info_of( children[i] );
+    info._num_nodes += ci._num_nodes;
+    info._num_nonterminals += ci._num_nonterminals;
+    info._flags |= ci._flags;
+
+    if ( ci._path_depth != expr_info::no_path && ci._path_depth + 1u < info._path_depth )
     {
-      seed ^= (std::hash<unsigned>{}(u) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 ));
+      info._path_depth = ci._path_depth + 1u;
+      info._path_child = i;
     }
-    return seed;
   }
-}; // expr_hash
+
+  if ( nonterminal )
+  {
+    info._num_nonterminals = 1u;
+    info._path_depth = 0u;
+    return info;
+  }
+
+  /* no double-negation */
+  if ( is_set( n._attr, expr_attr_enum::_no_double_application ) && children.size() == 1u )
+  {
+    const auto& child0 = node_of( children[0u] );
+    if ( child0._symbol == n._symbol && child0._attr == expr_attr_enum::_no_double_application )
+    {
+      info._flags |= expr_info_flags::_has_double_application;
+    }
+  }
+
+  /* canonical order of concrete operands */
+  if ( children.size() == 2u &&
+       info_of( children[0u] )._num_nonterminals == 0u &&
+       info_of( children[1u] )._num_nonterminals == 0u )
+  {
+    const auto c0 = children[0u];
+    const auto c1 = children[1u];
+    if ( ( is_set( n._attr, expr_attr_enum::_idempotent | expr_attr_enum::_commutative ) && c0 >= c1 ) ||
+         ( is_set( n._attr, expr_attr_enum::_commutative ) && c0 > c1 ) ||
+         ( is_set( n._attr, expr_attr_enum::_idempotent ) && c0 == c1 ) )
+    {
+      info._flags |= expr_info_flags::_has_idempotent_or_commutative;
+    }
+  }
+
+  return info;
+}
 
 /******************************************************************************
  * context                                                                    *
  ******************************************************************************/
 
-class context
+/* position in the node store to which a context can be rolled back */
+struct context_checkpoint
 {
-private:
-  using fun_strash_map_t = std::unordered_map<expr_node, unsigned, expr_hash >;
+  std::size_t _num_nodes;
+  std::size_t _num_pooled_children;
+}; // context_checkpoint
 
+/* Side tables keyed by node ids, e.g., memoised evaluation results, are
+ * registered with their context to forget the ids that a rollback frees. */
+class context_observer
+{
+public:
+  virtual ~context_observer() = default;
+
+  /* all nodes with id >= `first_id` were removed */
+  virtual void on_rollback( unsigned first_id ) = 0;
+}; // context_observer
+
+class context
+{
 public:
+  /* make_fun must not be called concurrently, see concurrent_context */
+  static constexpr bool thread_safe = false;
+
+  /* all nodes are allocated from an arena configured by `ps` */
+  explicit context( const arena_params& ps = {} )
+    : _arena( new arena( ps ) )
+    , _nodes( *_arena )
+    , _infos( *_arena )
+    , _child_pool( *_arena )
+  {}
+
+  /* interns a function symbol without creating a node */
+  unsigned make_symbol( const std::string& name )
+  {
+    return _symbols.intern( name );
+  }
+
   unsigned make_fun( const std::string& name, const std::vector<unsigned>& children = {}, const expr_attr attr = expr_attr_enum::_no )
   {
-    const auto e = expr_node( name, children, attr );
+    return make_fun( _symbols.intern( name ), children, attr );
+  }
+
+  unsigned make_fun( unsigned symbol, const std::vector<unsigned>& children = {}, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.data(), children.size(), attr );
+  }
+
+  unsigned make_fun( unsigned symbol, std::initializer_list<unsigned> children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.begin(), children.size(), attr );
+  }
+
+  unsigned make_fun( unsigned symbol, const expr_children& children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    return make_fun( symbol, children.begin(), children.size(), attr );
+  }
+
+  /* hash-conses a node */
+  unsigned make_fun( unsigned symbol, const unsigned *children, std::size_t num_children, const expr_attr attr = expr_attr_enum::_no )
+  {
+    assert( attr <= 0xffff && num_children <= 0xffff );
 
     /* structural hashing */
-    const auto it = _fun_strash.find( e );
-    if ( it != _fun_strash.end() )
-    {
-      return it->second;
-    }
+    return _fun_strash.find_or_insert( expr_hash{}( symbol, children, num_children ),
+      [&]( unsigned index ){
+        const auto& n = _nodes[ index ];
+        return n._symbol == symbol && n._arity == num_children &&
+          std::equal( children, children + num_children, children_of( n ).begin() );
+      },
+      [&](){
+        expr_node n;
+        n._symbol = symbol;
+        n._attr = attr;
+        n._arity = num_children;
+        if ( num_children <= expr_node::max_inline_children )
+        {
+          std::copy( children, children + num_children, n._children );
+        }
+        else
+        {
+          n._children[0u] = _child_pool.append( children, num_children );
+        }
 
-    const auto index = _exprs.size();
-    _exprs.push_back( e );
-    _fun_strash[e] = index;
-    return index;
+        const auto index = unsigned( _nodes.size() );
+        _infos.push_back( compute_info( n ) );
+        _nodes.push_back( n );
+        return index;
+      },
+      [this]( unsigned index ){
+        const auto& n = _nodes[ index ];
+        return expr_hash{}( n._symbol, children_of( n ).begin(), n._arity );
+      } );
   }
 
-  unsigned count_nonterminals( unsigned e ) const
+  context_checkpoint checkpoint() const
+  {
+    return context_checkpoint{ _nodes.size(), _child_pool.size() };
+  }
+
+  /* Removes all nodes created after `cp` in time proportional to their
+   * number; symbols and the memory of the node store are kept for reuse.
+   * Node ids obtained after the checkpoint must no longer be used. */
+  void rollback( const context_checkpoint& cp )
   {
-    const auto& expr = _exprs[ e ];
-    if ( expr._name[0] == '_' )
+    assert( cp._num_nodes <= _nodes.size() && cp._num_pooled_children <= _child_pool.size() );
+
+    const auto rehash = [this]( unsigned index ){
+      const auto& n = _nodes[ index ];
+      return expr_hash{}( n._symbol, children_of( n ).begin(), n._arity );
+    };
+    for ( auto index = _nodes.size(); index-- > cp._num_nodes; )
     {
-      return 1;
+      const auto erased = _fun_strash.erase( rehash( index ), index, rehash );
+      (void)erased;
+      assert( erased );
     }
 
-    auto counter = 0u;
-    for ( const auto& c : expr._children )
+    _nodes.truncate( cp._num_nodes );
+    _infos.truncate( cp._num_nodes );
+    _child_pool.truncate( cp._num_pooled_children );
+
+    for ( auto *o : _observers )
     {
-      counter += count_nonterminals( c );
+      o->on_rollback( unsigned( cp._num_nodes ) );
     }
+  }
 
-    return counter;
+  /* Observers are notified of rollbacks until they are detached.  They do
+   * not change the nodes, hence they can be attached to a const context. */
+  void attach( context_observer& o ) const
+  {
+    _observers.push_back( &o );
+  }
+
+  void detach( context_observer& o ) const
+  {
+    _observers.erase( std::remove( _observers.begin(), _observers.end(), &o ), _observers.end() );
+  }
+
+  /* number of nodes */
+  std::size_t size() const
+  {
+    return _nodes.size();
+  }
+
+  unsigned symbol( unsigned e ) const
+  {
+    return _nodes[ e ]._symbol;
+  }
+
+  const std::string& name( unsigned e ) const
+  {
+    return _symbols.name( _nodes[ e ]._symbol );
+  }
+
+  expr_attr attr( unsigned e ) const
+  {
+    return _nodes[ e ]._attr;
+  }
+
+  expr_children children( unsigned e ) const
+  {
+    return children_of( _nodes[ e ] );
+  }
+
+  bool is_nonterminal( unsigned e ) const
+  {
+    return _symbols.is_nonterminal( _nodes[ e ]._symbol );
+  }
+
+  unsigned count_nonterminals( unsigned e ) const
+  {
+    return _infos[ e ]._num_nonterminals;
   }
 
   unsigned count_nodes( unsigned e ) const
   {
-    const auto& expr = _exprs[ e ];
-    if ( expr._children.size() == 0u )
-    {
-      return 1;
-    }
+    return _infos[ e ]._num_nodes;
+  }
 
-    auto counter = 1u;
-    for ( const auto& c : expr._children )
-    {
-      counter += count_nodes( c );
-    }
+  bool is_concrete( unsigned e ) const
+  {
+    return _infos[ e ]._num_nonterminals == 0u;
+  }
+
+  /* depth of the shallowest non-terminal, expr_info::no_path if concrete */
+  unsigned concretizable_depth( unsigned e ) const
+  {
+    return _infos[ e ]._path_depth;
+  }
+
+  /* child on the path to the shallowest non-terminal */
+  unsigned concretizable_child( unsigned e ) const
+  {
+    return _infos[ e ]._path_child;
+  }
+
+  bool has_flags( unsigned e, unsigned flags ) const
+  {
+    return ( _infos[ e ]._flags & flags ) != 0u;
+  }
 
-    return counter;
+  const arena& node_arena() const
+  {
+    return *_arena;
+  }
+
+  /* probe lengths of the structural hashing table */
+  strash_statistics strash_stats() const
+  {
+    return _fun_strash.statistics( [this]( unsigned index ){
+        const auto& n = _nodes[ index ];
+        return expr_hash{}( n._symbol, children_of( n ).begin(), n._arity );
+      } );
+  }
+
+  /* bytes allocated for storing and hashing the nodes */
+  std::size_t memory_usage() const
+  {
+    return _arena->memory_usage() + _fun_strash.memory_usage();
+  }
+
+private:
+  expr_children children_of( const expr_node& n ) const
+  {
+    const auto *begin = n._arity <= expr_node::max_inline_children ? n._children : &_child_pool[ n._children[0u] ];
+    return expr_children( begin, begin + n._arity );
   }
 
-  fun_strash_map_t _fun_strash;
-  std::vector<expr_node> _exprs;
+  expr_info compute_info( const expr_node& n ) const
+  {
+    return compute_expr_info( n, children_of( n ), _symbols.is_nonterminal( n._symbol ),
+                              [this]( unsigned e ) -> const expr_info& { return _infos[ e ]; },
+                              [this]( unsigned e ) -> const expr_node& { return _nodes[ e ]; } );
+  }
+
+  symbol_table _symbols;
+  strash_table _fun_strash;
+
+  /* nodes, their metadata, and argument lists that do not fit inline */
+  std::unique_ptr<arena> _arena;
+  arena_vector<expr_node> _nodes;
+  arena_vector<expr_info> _infos;
+  arena_vector<unsigned> _child_pool;
+
+  mutable std::vector<context_observer*> _observers;
 }; // context
 
-class expr_printer
+template<typename Context>
+class basic_expr_printer
 {
 public:
-  expr_printer( const context& ctx )
+  basic_expr_printer( const Context& ctx )
     : _ctx( ctx )
   {}
 
+  virtual ~basic_expr_printer() {}
+
   virtual std::string as_string( unsigned e ) const
   {
-    const auto& expr = _ctx._exprs[ e ];
+    const auto children = _ctx.children( e );
 
-    auto str = expr._name;
-    if ( expr._children.size() > 0u )
+    auto str = _ctx.name( e );
+    if ( children.size() > 0u )
     {
       str += '(';
-      str += as_string( expr._children[ 0u ] );
-      for ( auto i = 1u; i < expr._children.size(); ++i )
+      str += as_string( children[ 0u ] );
+      for ( auto i = 1u; i < children.size(); ++i )
       {
         str += ',';
-        str += as_string( expr._children[ i ] );
+        str += as_string( children[ i ] );
       }
       str += ')';
     }
@@ -183,8 +529,14 @@ public:
     return str;
   }
 
-  const context& _ctx;
-};
+  const Context& _ctx;
+}; // basic_expr_printer
+
+class expr_printer : public basic_expr_printer<context>
+{
+public:
+  using basic_expr_printer::basic_expr_printer;
+}; // expr_printer
 
 } // namespace behemoth
 
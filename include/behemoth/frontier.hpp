@@ -0,0 +1,420 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <cassert>
+#include <deque>
+#include <iterator>
+#include <queue>
+#include <set>
+#include <vector>
+
+namespace behemoth
+{
+
+/* expression with associated cost */
+using cexpr_t = std::pair<unsigned,unsigned>;
+
+/* read-only view on a contiguous batch of expressions */
+class cexpr_span
+{
+public:
+  cexpr_span( const cexpr_t *begin, const cexpr_t *end )
+    : _begin( begin )
+    , _end( end )
+  {}
+
+  const cexpr_t *begin() const { return _begin; }
+  const cexpr_t *end() const { return _end; }
+  std::size_t size() const { return _end - _begin; }
+  bool empty() const { return _begin == _end; }
+  const cexpr_t& operator[]( std::size_t i ) const { return _begin[ i ]; }
+
+private:
+  const cexpr_t *_begin;
+  const cexpr_t *_end;
+}; // cexpr_span
+
+struct expr_greater_than
+{
+  expr_greater_than( context& ctx )
+    : _ctx( ctx )
+  {}
+
+  bool operator()(const cexpr_t& a, const cexpr_t& b) const
+  {
+    /* higher costs means greater */
+    if ( a.second > b.second ) return true;
+    if ( a.second < b.second ) return false;
+
+    /* more non-terminals means greater */
+    if ( _ctx.count_nonterminals( a.first ) > _ctx.count_nonterminals( b.first ) ) return true;
+    if ( _ctx.count_nonterminals( a.first ) < _ctx.count_nonterminals( b.first ) ) return false;
+
+    /* more nodes means greater */
+    if ( _ctx.count_nodes( a.first ) > _ctx.count_nodes( b.first ) ) return true;
+    if ( _ctx.count_nodes( a.first ) < _ctx.count_nodes( b.first ) ) return false;
+
+    return false;
+  }
+
+  context& _ctx;
+}; // expr_greater_than
+
+/******************************************************************************
+ * frontier policies                                                          *
+ ******************************************************************************/
+
+/* A frontier stores the abstract expressions that remain to be refined.  It
+ * is constructed from the context and provides push, top, pop, empty, and
+ * size.  Each policy documents the order in which top returns expressions;
+ * `cost_ordered` is true if that order never decreases in cost, such that
+ * the enumerator may stop at the first expression that exceeds the bound. */
+
+/* binary heap ordered by expr_greater_than: cheapest first, then fewer
+ * non-terminals, then fewer nodes */
+class heap_frontier
+{
+public:
+  static constexpr bool cost_ordered = true;
+
+  explicit heap_frontier( context& ctx )
+    : _queue( expr_greater_than( ctx ) )
+  {}
+
+  void push( const cexpr_t& e ) { _queue.push( e ); }
+  cexpr_t top() const { return _queue.top(); }
+  void pop() { _queue.pop(); }
+  bool empty() const { return _queue.empty(); }
+  std::size_t size() const { return _queue.size(); }
+
+private:
+  std::priority_queue<cexpr_t, std::vector<cexpr_t>, expr_greater_than> _queue;
+}; // heap_frontier
+
+/* Bucket queue with the same order as heap_frontier.
+ *
+ * Costs, non-terminal counts, and node counts are small integers, hence
+ * expressions are kept in buckets indexed by this triple and top scans for
+ * the first non-empty bucket from a lower bound that only decreases when an
+ * expression with a smaller key is pushed.  Push and pop are O(1) apart
+ * from skipping empty buckets; expressions with equal keys are returned in
+ * LIFO order.
+ */
+class bucket_frontier
+{
+public:
+  static constexpr bool cost_ordered = true;
+
+  explicit bucket_frontier( context& ctx )
+    : _ctx( ctx )
+  {}
+
+  void push( const cexpr_t& e )
+  {
+    const key k{ e.second, _ctx.count_nonterminals( e.first ), _ctx.count_nodes( e.first ) };
+    if ( k.cost >= _buckets.size() )
+    {
+      _buckets.resize( k.cost + 1u );
+    }
+    auto& by_nonterminals = _buckets[k.cost];
+    if ( k.nonterminals >= by_nonterminals.size() )
+    {
+      by_nonterminals.resize( k.nonterminals + 1u );
+    }
+    auto& by_nodes = by_nonterminals[k.nonterminals];
+    if ( k.nodes >= by_nodes.size() )
+    {
+      by_nodes.resize( k.nodes + 1u );
+    }
+
+    by_nodes[k.nodes].push_back( e.first );
+    ++_size;
+
+    if ( k < _min )
+    {
+      _min = k;
+    }
+  }
+
+  cexpr_t top() const
+  {
+    seek();
+    return { _buckets[_min.cost][_min.nonterminals][_min.nodes].back(), _min.cost };
+  }
+
+  void pop()
+  {
+    seek();
+    _buckets[_min.cost][_min.nonterminals][_min.nodes].pop_back();
+    --_size;
+  }
+
+  bool empty() const { return _size == 0u; }
+  std::size_t size() const { return _size; }
+
+private:
+  struct key
+  {
+    bool operator<( const key& other ) const
+    {
+      if ( cost != other.cost ) return cost < other.cost;
+      if ( nonterminals != other.nonterminals ) return nonterminals < other.nonterminals;
+      return nodes < other.nodes;
+    }
+
+    unsigned cost;
+    unsigned nonterminals;
+    unsigned nodes;
+  };
+
+  /* moves the lower bound to the first non-empty bucket */
+  void seek() const
+  {
+    assert( _size > 0u );
+    for ( auto c = _min.cost; c < _buckets.size(); ++c )
+    {
+      const auto& by_nonterminals = _buckets[c];
+      for ( auto t = c == _min.cost ? _min.nonterminals : 0u; t < by_nonterminals.size(); ++t )
+      {
+        const auto& by_nodes = by_nonterminals[t];
+        for ( auto n = ( c == _min.cost && t == _min.nonterminals ) ? _min.nodes : 0u; n < by_nodes.size(); ++n )
+        {
+          if ( !by_nodes[n].empty() )
+          {
+            _min = key{ c, t, n };
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  context& _ctx;
+  std::vector<std::vector<std::vector<std::vector<unsigned>>>> _buckets;
+  std::size_t _size = 0u;
+  mutable key _min{ 0u, 0u, 0u };
+}; // bucket_frontier
+
+/* breadth-first by cost: cheapest first, expressions of equal cost in the
+ * order in which they were pushed */
+class bfs_frontier
+{
+public:
+  static constexpr bool cost_ordered = true;
+
+  explicit bfs_frontier( context& ctx )
+  {
+    (void)ctx;
+  }
+
+  void push( const cexpr_t& e )
+  {
+    if ( e.second >= _layers.size() )
+    {
+      _layers.resize( e.second + 1u );
+    }
+    _layers[e.second].push_back( e.first );
+    ++_size;
+
+    if ( e.second < _min_cost )
+    {
+      _min_cost = e.second;
+    }
+  }
+
+  cexpr_t top() const
+  {
+    seek();
+    return { _layers[_min_cost].front(), _min_cost };
+  }
+
+  void pop()
+  {
+    seek();
+    _layers[_min_cost].pop_front();
+    --_size;
+  }
+
+  bool empty() const { return _size == 0u; }
+  std::size_t size() const { return _size; }
+
+private:
+  void seek() const
+  {
+    assert( _size > 0u );
+    while ( _layers[_min_cost].empty() )
+    {
+      ++_min_cost;
+    }
+  }
+
+  std::vector<std::deque<unsigned>> _layers;
+  std::size_t _size = 0u;
+  mutable unsigned _min_cost = 0u;
+}; // bfs_frontier
+
+/* Depth-first: the most recently pushed expression first.
+ *
+ * The frontier only holds the siblings along the current refinement path,
+ * hence it stays small, but expressions are not returned in cost order and
+ * the enumerator skips (rather than stops at) expressions that exceed the
+ * cost bound.
+ */
+class dfs_frontier
+{
+public:
+  static constexpr bool cost_ordered = false;
+
+  explicit dfs_frontier( context& ctx )
+  {
+    (void)ctx;
+  }
+
+  void push( const cexpr_t& e ) { _stack.push_back( e ); }
+  cexpr_t top() const { return _stack.back(); }
+  void pop() { _stack.pop_back(); }
+  bool empty() const { return _stack.empty(); }
+  std::size_t size() const { return _stack.size(); }
+
+private:
+  std::vector<cexpr_t> _stack;
+}; // dfs_frontier
+
+/* Beam search: cost layers in the order of heap_frontier, but each cost
+ * layer keeps at most `width` expressions.  When a layer is full, the
+ * greatest expression with respect to expr_greater_than is dropped, hence
+ * the enumeration is incomplete but the frontier is bounded by `width`
+ * times the number of cost layers.
+ */
+class beam_frontier
+{
+public:
+  static constexpr bool cost_ordered = true;
+
+  explicit beam_frontier( context& ctx, std::size_t width = 1024u )
+    : _ctx( ctx )
+    , _width( width )
+  {
+    assert( width > 0u );
+  }
+
+  void push( const cexpr_t& e )
+  {
+    if ( e.second >= _layers.size() )
+    {
+      _layers.resize( e.second + 1u );
+    }
+
+    auto& layer = _layers[e.second];
+    const entry en{ _ctx.count_nonterminals( e.first ), _ctx.count_nodes( e.first ), e.first };
+    if ( layer.find( en ) != layer.end() )
+    {
+      /* already in the beam */
+      return;
+    }
+    if ( layer.size() == _width )
+    {
+      const auto worst = std::prev( layer.end() );
+      if ( !( en < *worst ) )
+      {
+        ++_dropped;
+        return;
+      }
+      layer.erase( worst );
+      --_size;
+      ++_dropped;
+    }
+    if ( layer.insert( en ).second )
+    {
+      ++_size;
+    }
+
+    if ( e.second < _min_cost )
+    {
+      _min_cost = e.second;
+    }
+  }
+
+  cexpr_t top() const
+  {
+    seek();
+    return { _layers[_min_cost].begin()->expr, _min_cost };
+  }
+
+  void pop()
+  {
+    seek();
+    _layers[_min_cost].erase( _layers[_min_cost].begin() );
+    --_size;
+  }
+
+  bool empty() const { return _size == 0u; }
+  std::size_t size() const { return _size; }
+
+  /* number of expressions that did not fit into the beam */
+  std::size_t num_dropped() const { return _dropped; }
+
+private:
+  struct entry
+  {
+    bool operator<( const entry& other ) const
+    {
+      if ( nonterminals != other.nonterminals ) return nonterminals < other.nonterminals;
+      if ( nodes != other.nodes ) return nodes < other.nodes;
+      return expr < other.expr;
+    }
+
+    unsigned nonterminals;
+    unsigned nodes;
+    unsigned expr;
+  };
+
+  void seek() const
+  {
+    assert( _size > 0u );
+    while ( _layers[_min_cost].empty() )
+    {
+      ++_min_cost;
+    }
+  }
+
+  context& _ctx;
+  std::size_t _width;
+  std::vector<std::set<entry>> _layers;
+  std::size_t _size = 0u;
+  std::size_t _dropped = 0u;
+  mutable unsigned _min_cost = 0u;
+}; // beam_frontier
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
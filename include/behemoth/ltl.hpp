@@ -0,0 +1,340 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <behemoth/node_table.hpp>
+#include <behemoth/truth_table.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * trace_set                                                                  *
+ ******************************************************************************/
+
+/* Finite traces stored as one bitvector per variable over time.
+ *
+ * The traces are concatenated, each starting at a word boundary, such that
+ * Boolean operators apply to all traces at once and temporal operators scan
+ * the words of each trace independently.  Bits past the end of a trace are
+ * zero.
+ */
+class trace_set
+{
+public:
+  explicit trace_set( unsigned num_vars )
+    : _num_vars( num_vars )
+    , _values( num_vars )
+  {
+    if ( num_vars > 64u )
+    {
+      throw std::invalid_argument( "traces support at most 64 variables" );
+    }
+  }
+
+  /* appends a trace; bit i of `steps[t]` is the value of variable i at time t */
+  void add_trace( const std::vector<std::uint64_t>& steps )
+  {
+    if ( steps.empty() )
+    {
+      throw std::invalid_argument( "traces must not be empty" );
+    }
+
+    const auto first = _num_words;
+    const auto length = unsigned( steps.size() );
+    _num_words += ( length + 63u ) / 64u;
+    _traces.push_back( trace{ first, length } );
+
+    for ( auto& v : _values )
+    {
+      v.resize( _num_words );
+    }
+    _valid.resize( _num_words );
+    _last.resize( _num_words );
+
+    for ( auto t = 0u; t < length; ++t )
+    {
+      const auto w = first + t / 64u;
+      const auto bit = UINT64_C( 1 ) << ( t % 64u );
+      for ( auto i = 0u; i < _num_vars; ++i )
+      {
+        if ( ( steps[t] >> i ) & 1u )
+        {
+          _values[i][w] |= bit;
+        }
+      }
+      _valid[w] |= bit;
+    }
+    _last[first + ( length - 1u ) / 64u] |= UINT64_C( 1 ) << ( ( length - 1u ) % 64u );
+  }
+
+  unsigned num_vars() const { return _num_vars; }
+  std::size_t num_traces() const { return _traces.size(); }
+  std::size_t num_words() const { return _num_words; }
+
+  /* first word and length of trace `i` */
+  std::size_t first_word( std::size_t i ) const { return _traces[i].first_word; }
+  unsigned length( std::size_t i ) const { return _traces[i].length; }
+  std::size_t num_words( std::size_t i ) const { return ( _traces[i].length + 63u ) / 64u; }
+
+  const std::uint64_t *values( unsigned var ) const { return _values[var].data(); }
+
+  /* positions that belong to a trace */
+  const std::uint64_t *valid() const { return _valid.data(); }
+
+  /* the last position of every trace */
+  const std::uint64_t *last() const { return _last.data(); }
+
+private:
+  struct trace
+  {
+    std::size_t first_word;
+    unsigned length;
+  };
+
+  unsigned _num_vars;
+  std::size_t _num_words = 0u;
+  std::vector<trace> _traces;
+  std::vector<std::vector<std::uint64_t>> _values;
+  std::vector<std::uint64_t> _valid;
+  std::vector<std::uint64_t> _last;
+}; // trace_set
+
+/******************************************************************************
+ * ltl_evaluator                                                              *
+ ******************************************************************************/
+
+/* LTL meaning of a function symbol */
+enum class ltl_op : std::uint8_t
+{
+  unknown,  /* not evaluable, e.g., non-terminals */
+  variable,
+  constant0,
+  constant1,
+  not_,
+  and_,
+  or_,
+  next,
+  eventually,
+  globally,
+  until
+}; // ltl_op
+
+/* Evaluates LTL formulae on all positions of a set of finite traces.
+ *
+ * The result of a formula is a bitvector over the positions of all traces of
+ * the set.  Finite-trace semantics are used: X is false at the last position
+ * of a trace, F, G, and U only look at the remaining positions of the same
+ * trace.
+ */
+class ltl_evaluator : public node_evaluator<ltl_evaluator, std::uint64_t, ltl_op>
+{
+  using base_t = node_evaluator<ltl_evaluator, std::uint64_t, ltl_op>;
+  friend base_t;
+
+public:
+  ltl_evaluator( const context& ctx, const trace_set& traces, simd_isa isa = detect_simd_isa(), const node_table_params& ps = {} )
+    : base_t( ctx, traces.num_words(), ps )
+    , _traces( traces )
+    , _kernels( isa )
+  {}
+
+  /* `symbol` denotes variable `index` of the traces */
+  void add_variable( unsigned symbol, unsigned index )
+  {
+    if ( index >= _traces.num_vars() )
+    {
+      throw std::invalid_argument( "variable index out of range" );
+    }
+    set_meaning( symbol, symbol_meaning{ ltl_op::variable, index } );
+  }
+
+  /* evaluate( e ) returns the positions at which `e` holds, as
+   * trace_set::num_words() words */
+
+  /* whether `e` holds at the first position of trace `i` */
+  bool holds( unsigned e, std::size_t i )
+  {
+    const auto *r = evaluate( e );
+    return r && ( r[_traces.first_word( i )] & 1u );
+  }
+
+  /* number of traces on which `e` holds */
+  std::size_t count_traces( unsigned e )
+  {
+    const auto *r = evaluate( e );
+    if ( !r )
+    {
+      return 0u;
+    }
+
+    std::size_t count = 0u;
+    for ( auto i = 0u; i < _traces.num_traces(); ++i )
+    {
+      count += r[_traces.first_word( i )] & 1u;
+    }
+    return count;
+  }
+
+private:
+  bool accepts( ltl_op op, std::size_t num_children ) const
+  {
+    switch ( op )
+    {
+    case ltl_op::not_:
+    case ltl_op::next:
+    case ltl_op::eventually:
+    case ltl_op::globally:
+      return num_children == 1u;
+    case ltl_op::and_:
+    case ltl_op::or_:
+    case ltl_op::until:
+      return num_children == 2u;
+    default:
+      return num_children == 0u;
+    }
+  }
+
+  void compute( const symbol_meaning& m, std::uint64_t *out, const std::uint64_t * const *children, std::size_t )
+  {
+    const auto n = _traces.num_words();
+    switch ( m.op )
+    {
+    case ltl_op::variable:
+      std::copy( _traces.values( m.index ), _traces.values( m.index ) + n, out );
+      break;
+    case ltl_op::constant0:
+      std::fill( out, out + n, UINT64_C( 0 ) );
+      break;
+    case ltl_op::constant1:
+      std::copy( _traces.valid(), _traces.valid() + n, out );
+      break;
+    case ltl_op::not_:
+      _kernels.xor_( out, children[0u], _traces.valid(), n );
+      break;
+    case ltl_op::and_:
+      _kernels.and_( out, children[0u], children[1u], n );
+      break;
+    case ltl_op::or_:
+      _kernels.or_( out, children[0u], children[1u], n );
+      break;
+    case ltl_op::next:
+      next( out, children[0u] );
+      break;
+    case ltl_op::eventually:
+      eventually( out, children[0u] );
+      break;
+    case ltl_op::globally:
+      /* G a = !F!a */
+      _kernels.xor_( out, children[0u], _traces.valid(), n );
+      eventually( out, out );
+      _kernels.xor_( out, out, _traces.valid(), n );
+      break;
+    case ltl_op::until:
+      until( out, children[0u], children[1u] );
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* X a: position t takes the value of t + 1 within the same trace */
+  void next( std::uint64_t *out, const std::uint64_t *a ) const
+  {
+    for ( auto i = 0u; i < _traces.num_traces(); ++i )
+    {
+      const auto first = _traces.first_word( i );
+      const auto end = first + _traces.num_words( i );
+      for ( auto w = first; w < end; ++w )
+      {
+        const auto carry = w + 1u < end ? a[w + 1u] << 63u : UINT64_C( 0 );
+        out[w] = ( ( a[w] >> 1u ) | carry ) & _traces.valid()[w] & ~_traces.last()[w];
+      }
+    }
+  }
+
+  /* F a: suffix-OR per trace, scanning the words backwards; `out` may alias
+   * `a` */
+  void eventually( std::uint64_t *out, const std::uint64_t *a ) const
+  {
+    for ( auto i = 0u; i < _traces.num_traces(); ++i )
+    {
+      const auto first = _traces.first_word( i );
+      auto carry = false;
+      for ( auto w = first + _traces.num_words( i ); w-- > first; )
+      {
+        /* smear the last position that holds down to position 0 */
+        auto x = a[w];
+        for ( auto s = 1u; s < 64u; s <<= 1u )
+        {
+          x |= x >> s;
+        }
+        out[w] = ( carry ? ~UINT64_C( 0 ) : x ) & _traces.valid()[w];
+        carry = carry || x != 0u;
+      }
+    }
+  }
+
+  /* a U b: r(t) = b(t) | ( a(t) & r(t + 1) ), solved per word by parallel
+   * prefix doubling and chained backwards through the words of a trace */
+  void until( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b ) const
+  {
+    for ( auto i = 0u; i < _traces.num_traces(); ++i )
+    {
+      const auto first = _traces.first_word( i );
+      auto carry = false;
+      for ( auto w = first + _traces.num_words( i ); w-- > first; )
+      {
+        auto g = b[w];
+        auto p = a[w];
+        for ( auto s = 1u; s < 64u; s <<= 1u )
+        {
+          g |= p & ( g >> s );
+          p &= ( p >> s ) | ( ~UINT64_C( 0 ) << ( 64u - s ) );
+        }
+        /* p(t) holds iff a holds from t to the end of the word */
+        out[w] = ( g | ( carry ? p : UINT64_C( 0 ) ) ) & _traces.valid()[w];
+        carry = out[w] & 1u;
+      }
+    }
+  }
+
+  const trace_set& _traces;
+  truth_table_kernels _kernels;
+}; // ltl_evaluator
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
@@ -0,0 +1,389 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * node_table                                                                 *
+ ******************************************************************************/
+
+struct node_table_params
+{
+  /* upper bound on the bytes of stored values, 0 for no bound */
+  std::size_t max_bytes = 0u;
+}; // node_table_params
+
+/* Side table that maps node ids of a context to values.
+ *
+ * The value of a node is a block of `value_size` elements of T.  Node ids
+ * index a dense array of slots, and blocks are stored contiguously in slot
+ * order.  If the table is bounded, a full table reuses the slot of a node
+ * chosen by the CLOCK policy: a hand sweeps over the slots, sparing slots
+ * that were looked up since its last visit and slots that are pinned.  If
+ * all slots are pinned, the table grows beyond its bound.  Slots of erased
+ * nodes are reused first.
+ *
+ * Pointers to values are invalidated by insert().
+ */
+template<typename T>
+class node_table
+{
+public:
+  static constexpr unsigned npos = std::numeric_limits<unsigned>::max();
+
+  explicit node_table( std::size_t value_size = 1u, const node_table_params& ps = {} )
+    : _value_size( value_size )
+  {
+    if ( ps.max_bytes > 0u )
+    {
+      _max_slots = std::max<std::size_t>( ps.max_bytes / std::max<std::size_t>( value_size * sizeof( T ), 1u ), 1u );
+    }
+  }
+
+  std::size_t value_size() const
+  {
+    return _value_size;
+  }
+
+  /* value of node `id`, or nullptr if it is not stored */
+  T *find( unsigned id )
+  {
+    if ( id >= _slot_of.size() || _slot_of[id] == npos )
+    {
+      return nullptr;
+    }
+
+    const auto slot = _slot_of[id];
+    _referenced[slot] = true;
+    return value( slot );
+  }
+
+  bool contains( unsigned id ) const
+  {
+    return id < _slot_of.size() && _slot_of[id] != npos;
+  }
+
+  /* returns storage for the value of node `id`, whose contents are
+   * unspecified; may evict the value of another node */
+  T *insert( unsigned id )
+  {
+    if ( id >= _slot_of.size() )
+    {
+      _slot_of.resize( id + 1u, npos );
+    }
+    if ( _slot_of[id] != npos )
+    {
+      return find( id );
+    }
+
+    auto slot = npos;
+    if ( !_free.empty() )
+    {
+      slot = _free.back();
+      _free.pop_back();
+      _owner[slot] = id;
+      _referenced[slot] = true;
+    }
+    else if ( _max_slots == 0u || _owner.size() < _max_slots || ( slot = victim() ) == npos )
+    {
+      slot = unsigned( _owner.size() );
+      _owner.push_back( id );
+      _referenced.push_back( true );
+      _pins.push_back( 0u );
+      _values.resize( _values.size() + _value_size );
+    }
+    else
+    {
+      _slot_of[_owner[slot]] = npos;
+      _owner[slot] = id;
+      _referenced[slot] = true;
+      ++_num_evictions;
+    }
+
+    _slot_of[id] = slot;
+    return value( slot );
+  }
+
+  /* a pinned value is not evicted; pins nest */
+  void pin( unsigned id )
+  {
+    ++_pins[_slot_of[id]];
+  }
+
+  void unpin( unsigned id )
+  {
+    --_pins[_slot_of[id]];
+  }
+
+  /* erases the values of all nodes with id >= `first_id` */
+  void truncate( unsigned first_id )
+  {
+    for ( auto id = std::size_t( first_id ); id < _slot_of.size(); ++id )
+    {
+      const auto slot = _slot_of[id];
+      if ( slot != npos )
+      {
+        _owner[slot] = npos;
+        _pins[slot] = 0u;
+        _free.push_back( slot );
+      }
+    }
+    if ( first_id < _slot_of.size() )
+    {
+      _slot_of.resize( first_id );
+    }
+  }
+
+  void clear()
+  {
+    _slot_of.clear();
+    _owner.clear();
+    _referenced.clear();
+    _pins.clear();
+    _values.clear();
+    _free.clear();
+    _hand = 0u;
+    _num_evictions = 0u;
+  }
+
+  /* number of stored values */
+  std::size_t size() const
+  {
+    return _owner.size() - _free.size();
+  }
+
+  std::size_t num_evictions() const
+  {
+    return _num_evictions;
+  }
+
+  /* bytes allocated for slots and values */
+  std::size_t memory_usage() const
+  {
+    return _slot_of.capacity() * sizeof( unsigned ) + _owner.capacity() * ( sizeof( unsigned ) * 2u + 1u ) + _values.capacity() * sizeof( T );
+  }
+
+private:
+  T *value( unsigned slot )
+  {
+    return _values.data() + std::size_t( slot ) * _value_size;
+  }
+
+  /* next unreferenced, unpinned slot under the clock hand */
+  unsigned victim()
+  {
+    for ( auto steps = 2u * _owner.size(); steps > 0u; --steps )
+    {
+      const auto slot = _hand;
+      _hand = _hand + 1u == _owner.size() ? 0u : _hand + 1u;
+      if ( _pins[slot] != 0u || _owner[slot] == npos )
+      {
+        continue;
+      }
+      if ( !_referenced[slot] )
+      {
+        return slot;
+      }
+      _referenced[slot] = false;
+    }
+    return npos;
+  }
+
+  std::size_t _value_size;
+  std::size_t _max_slots = 0u;
+  std::size_t _num_evictions = 0u;
+
+  std::vector<unsigned> _slot_of;
+  std::vector<unsigned> _owner;
+  std::vector<bool> _referenced;
+  std::vector<unsigned> _pins;
+  std::vector<T> _values;
+  std::vector<unsigned> _free;
+  unsigned _hand = 0u;
+}; // node_table
+
+template<typename T>
+constexpr unsigned node_table<T>::npos;
+
+/******************************************************************************
+ * node_evaluator                                                             *
+ ******************************************************************************/
+
+/* Memoised bottom-up evaluation of concrete expressions over a node_table.
+ *
+ * The value of an expression is kept per node id, hence a subexpression that
+ * is shared by many expressions is evaluated once.
+ *
+ * The meaning of a function symbol is an operator of the enumeration `Op`,
+ * which must have the members `unknown` and `variable`.  `Derived` provides
+ * the hooks
+ *
+ *   bool accepts( Op op, std::size_t num_children ) const;
+ *   void compute( const symbol_meaning& m, T *out, const T * const *children, std::size_t num_children );
+ *
+ * which check the arity of an operator and compute the value of a node from
+ * the values of its children.  The evaluator is attached to its context and
+ * forgets the values of nodes that are removed by context::rollback.
+ */
+template<typename Derived, typename T, typename Op>
+class node_evaluator : public context_observer
+{
+public:
+  struct symbol_meaning
+  {
+    Op op = Op::unknown;
+    unsigned index = 0u; /* of variables */
+  };
+
+  node_evaluator( const context& ctx, std::size_t value_size, const node_table_params& ps = {} )
+    : _ctx( ctx )
+    , _table( value_size, ps )
+  {
+    _ctx.attach( *this );
+  }
+
+  ~node_evaluator()
+  {
+    _ctx.detach( *this );
+  }
+
+  /* the address is registered with the context */
+  node_evaluator( const node_evaluator& ) = delete;
+  node_evaluator& operator=( const node_evaluator& ) = delete;
+
+  void add_operator( unsigned symbol, Op op )
+  {
+    set_meaning( symbol, symbol_meaning{ op, 0u } );
+  }
+
+  /* value of `e`, or nullptr if `e` contains a symbol without meaning; the
+   * pointer is invalidated when a node that has not been evaluated before is
+   * evaluated */
+  const T *evaluate( unsigned e )
+  {
+    if ( auto *v = _table.find( e ) )
+    {
+      return v;
+    }
+
+    const auto symbol = _ctx.symbol( e );
+    const auto children = _ctx.children( e );
+    if ( symbol >= _meanings.size() || _meanings[symbol].op == Op::unknown || !derived().accepts( _meanings[symbol].op, children.size() ) )
+    {
+      return nullptr;
+    }
+
+    /* children stay pinned until the value of `e` is computed */
+    auto num_pinned = 0u;
+    for ( ; num_pinned < children.size(); ++num_pinned )
+    {
+      if ( !evaluate( children[num_pinned] ) )
+      {
+        break;
+      }
+      _table.pin( children[num_pinned] );
+    }
+
+    T *out = nullptr;
+    if ( num_pinned == children.size() )
+    {
+      out = _table.insert( e );
+      _args.clear();
+      for ( const auto c : children )
+      {
+        _args.push_back( _table.find( c ) );
+      }
+      derived().compute( _meanings[symbol], out, _args.data(), _args.size() );
+    }
+
+    for ( auto i = 0u; i < num_pinned; ++i )
+    {
+      _table.unpin( children[i] );
+    }
+    return out;
+  }
+
+  const node_table<T>& table() const
+  {
+    return _table;
+  }
+
+  /* forgets the values of all nodes with id >= `first_id` */
+  void truncate( unsigned first_id )
+  {
+    _table.truncate( first_id );
+  }
+
+  /* forgets all values */
+  void clear()
+  {
+    _table.clear();
+  }
+
+  virtual void on_rollback( unsigned first_id ) override
+  {
+    truncate( first_id );
+  }
+
+protected:
+  void set_meaning( unsigned symbol, const symbol_meaning& m )
+  {
+    if ( symbol >= _meanings.size() )
+    {
+      _meanings.resize( symbol + 1u );
+    }
+    _meanings[symbol] = m;
+  }
+
+  const context& _ctx;
+
+private:
+  Derived& derived()
+  {
+    return static_cast<Derived&>( *this );
+  }
+
+  node_table<T> _table;
+  std::vector<symbol_meaning> _meanings;
+  std::vector<const T*> _args;
+}; // node_evaluator
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
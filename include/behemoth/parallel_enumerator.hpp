@@ -0,0 +1,378 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/enumerator.hpp>
+#include <behemoth/concurrent_context.hpp>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * work_deque                                                                 *
+ ******************************************************************************/
+
+/* Double-ended queue of expressions shared by one owner and its thieves: the
+ * owner pushes and pops at the back, thieves steal from the front, such that
+ * the owner continues depth-first while thieves take the oldest items. */
+class work_deque
+{
+public:
+  void push( unsigned e )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    _items.push_back( e );
+  }
+
+  bool pop( unsigned& e )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    if ( _items.empty() )
+    {
+      return false;
+    }
+    e = _items.back();
+    _items.pop_back();
+    return true;
+  }
+
+  bool steal( unsigned& e )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    if ( _items.empty() )
+    {
+      return false;
+    }
+    e = _items.front();
+    _items.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex _mutex;
+  std::deque<unsigned> _items;
+}; // work_deque
+
+/******************************************************************************
+ * parallel_enumerator                                                        *
+ ******************************************************************************/
+
+/* Multi-threaded enumerator that processes one cost layer at a time.
+ *
+ * The abstract expressions of the cheapest cost are distributed over the
+ * workers' deques; idle workers steal from the others.  Refinements of the
+ * same cost (rules of cost 0) stay in the worker's deque, more expensive
+ * refinements and concrete expressions are buffered per worker.  When all
+ * deques are drained (the per-cost barrier), the concrete expressions whose
+ * cost can no longer be produced are reported by on_concrete_expression on
+ * the thread that called run(); hence all concrete expressions of cost c
+ * are reported before any of cost c + 1, but in no particular order within
+ * a cost.
+ *
+ * `Context` is shared by all workers.  A concurrent_context is accessed
+ * without further synchronization; a context is guarded by a mutex during
+ * each refinement.  is_redundant_in_search_order is called by the workers
+ * and must be thread-safe.
+ */
+template<typename Context>
+class basic_parallel_enumerator
+{
+public:
+  /* `num_threads` = 0 uses one thread per hardware thread */
+  basic_parallel_enumerator( Context& ctx, const rules_t& rules, int max_cost, unsigned num_threads = 0u )
+    : ctx( ctx )
+    , rules( rules )
+    , index( rules )
+    , max_cost( max_cost )
+  {
+    if ( num_threads == 0u )
+    {
+      num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    for ( auto i = 0u; i < num_threads; ++i )
+    {
+      _workers.emplace_back( new worker( ctx ) );
+    }
+  }
+
+  virtual ~basic_parallel_enumerator() {}
+
+  void add_expression( unsigned e )
+  {
+    layer( _abstract, 0u ).push_back( e );
+  }
+
+  /* enumerates until all abstract expressions below the cost bound are
+   * refined or termination is signaled */
+  void run();
+
+  virtual bool is_redundant_in_search_order( unsigned e ) const
+  {
+    return ctx.has_flags( e, expr_info_flags::_has_double_application | expr_info_flags::_has_idempotent_or_commutative );
+  }
+
+  virtual void on_concrete_expression( cexpr_t e )
+  {
+    (void)e;
+  }
+
+  void signal_termination()
+  {
+    quit_enumeration = true;
+  }
+
+  bool is_running() const
+  {
+    return !quit_enumeration;
+  }
+
+  unsigned num_threads() const
+  {
+    return unsigned( _workers.size() );
+  }
+
+protected:
+  Context& ctx;
+  std::atomic<bool> quit_enumeration{ false };
+
+  rules_t rules;
+  rule_index index;
+  int max_cost;
+
+  unsigned current_costs = 0u;
+
+private:
+  using layers_t = std::vector<std::vector<unsigned>>;
+
+  struct worker
+  {
+    explicit worker( Context& ctx )
+      : refiner( ctx )
+    {}
+
+    work_deque queue;
+    basic_expr_refiner<Context> refiner;
+    layers_t abstract;
+    layers_t concrete;
+  };
+
+  static std::vector<unsigned>& layer( layers_t& layers, unsigned cost )
+  {
+    if ( cost >= layers.size() )
+    {
+      layers.resize( cost + 1u );
+    }
+    return layers[cost];
+  }
+
+  void merge_buffers();
+  void report_below( unsigned cost );
+  void process_layer( unsigned cost );
+  void work( unsigned id, unsigned cost );
+  void refine( worker& w, unsigned e, unsigned cost );
+
+  std::vector<std::unique_ptr<worker>> _workers;
+  std::mutex _ctx_mutex; /* unused if Context::thread_safe */
+  std::atomic<std::size_t> _pending{ 0u };
+
+  /* abstract and concrete expressions of later layers by cost */
+  layers_t _abstract;
+  layers_t _concrete;
+}; // basic_parallel_enumerator
+
+/* parallel enumerator over a sequential context */
+class parallel_enumerator : public basic_parallel_enumerator<context>
+{
+public:
+  using basic_parallel_enumerator::basic_parallel_enumerator;
+}; // parallel_enumerator
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::run()
+{
+  while ( is_running() )
+  {
+    merge_buffers();
+
+    auto cost = 0u;
+    while ( cost < _abstract.size() && _abstract[cost].empty() )
+    {
+      ++cost;
+    }
+
+    if ( cost == _abstract.size() || cost >= unsigned( max_cost ) )
+    {
+      report_below( unsigned( _concrete.size() ) );
+      if ( cost != _abstract.size() )
+      {
+        std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+      }
+      quit_enumeration = true;
+      return;
+    }
+
+    /* no layer below `cost` is left to produce concrete expressions */
+    report_below( cost );
+
+    if ( cost > current_costs )
+    {
+      std::cout << "[i] finished considering expressions of cost " << (current_costs+1u) << std::endl;
+      current_costs = cost;
+    }
+
+    process_layer( cost );
+  }
+}
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::merge_buffers()
+{
+  for ( auto& w : _workers )
+  {
+    for ( auto c = 0u; c < w->abstract.size(); ++c )
+    {
+      auto& to = layer( _abstract, c );
+      to.insert( to.end(), w->abstract[c].begin(), w->abstract[c].end() );
+    }
+    for ( auto c = 0u; c < w->concrete.size(); ++c )
+    {
+      auto& to = layer( _concrete, c );
+      to.insert( to.end(), w->concrete[c].begin(), w->concrete[c].end() );
+    }
+    w->abstract.clear();
+    w->concrete.clear();
+  }
+}
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::report_below( unsigned cost )
+{
+  for ( auto c = 0u; c < std::min<std::size_t>( cost, _concrete.size() ); ++c )
+  {
+    for ( const auto e : _concrete[c] )
+    {
+      if ( !is_running() ) return;
+      on_concrete_expression( { e, c } );
+    }
+    std::vector<unsigned>().swap( _concrete[c] );
+  }
+}
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::process_layer( unsigned cost )
+{
+  auto items = std::move( _abstract[cost] );
+  _abstract[cost].clear();
+
+  _pending = items.size();
+  for ( auto i = 0u; i < items.size(); ++i )
+  {
+    _workers[i % _workers.size()]->queue.push( items[i] );
+  }
+  std::vector<unsigned>().swap( items );
+
+  std::vector<std::thread> threads;
+  for ( auto id = 1u; id < _workers.size(); ++id )
+  {
+    threads.emplace_back( [this, id, cost](){ work( id, cost ); } );
+  }
+  work( 0u, cost );
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+}
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::work( unsigned id, unsigned cost )
+{
+  auto& w = *_workers[id];
+  unsigned e;
+  while ( _pending.load() > 0u )
+  {
+    auto found = w.queue.pop( e );
+    for ( auto i = 1u; !found && i < _workers.size(); ++i )
+    {
+      found = _workers[( id + i ) % _workers.size()]->queue.steal( e );
+    }
+    if ( !found )
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    if ( is_running() )
+    {
+      refine( w, e, cost );
+    }
+    --_pending;
+  }
+}
+
+template<typename Context>
+void basic_parallel_enumerator<Context>::refine( worker& w, unsigned e, unsigned cost )
+{
+  std::unique_lock<std::mutex> lock( _ctx_mutex, std::defer_lock );
+  if ( !Context::thread_safe )
+  {
+    lock.lock();
+  }
+
+  auto p = get_path_to_concretizable_element( ctx, e );
+  w.refiner.refine( e, p, index, [&]( unsigned child, unsigned child_cost ){
+      if ( is_redundant_in_search_order( child ) ) return;
+
+      if ( is_concrete( ctx, child ) )
+      {
+        layer( w.concrete, cost + child_cost ).push_back( child );
+      }
+      else if ( child_cost == 0u )
+      {
+        /* same layer, count before publishing */
+        ++_pending;
+        w.queue.push( child );
+      }
+      else
+      {
+        layer( w.abstract, cost + child_cost ).push_back( child );
+      }
+    } );
+}
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
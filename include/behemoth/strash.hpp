@@ -0,0 +1,364 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <limits>
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * strash_table                                                               *
+ ******************************************************************************/
+
+struct strash_statistics
+{
+  std::size_t size = 0u;
+  std::size_t capacity = 0u;
+  std::size_t max_probe_length = 0u;
+  double avg_probe_length = 0.0; /* slots inspected by a successful lookup */
+}; // strash_statistics
+
+/* Open-addressing hash table for structural hashing.
+ *
+ * The table only stores node indices; keys are compared in place against the
+ * node store by a caller-supplied predicate.  The home slot of a hash value
+ * is obtained by Fibonacci hashing, i.e., from the high bits of the product
+ * with 2^64/phi, and collisions are resolved by linear probing.  When the
+ * load factor exceeds 1/2 a table of twice the size is allocated and the
+ * entries of the old table are migrated a few slots at a time on every
+ * insertion, such that no single insertion pays for a full rehash.  Slots
+ * hold `index + 1` so that zero-initialized memory is an empty table and
+ * large tables can be obtained from calloc without touching them.
+ */
+class strash_table
+{
+public:
+  static constexpr unsigned npos = std::numeric_limits<unsigned>::max();
+
+  explicit strash_table( std::size_t initial_capacity = 1024u )
+  {
+    std::size_t capacity = 16u;
+    while ( capacity < initial_capacity )
+    {
+      capacity <<= 1u;
+    }
+    _table = allocate( capacity );
+    _mask = capacity - 1u;
+    _shift = shift_for( capacity );
+  }
+
+  /* returns the index for which `match` holds, or npos */
+  template<typename Match>
+  unsigned find( std::size_t hash, Match&& match ) const
+  {
+    auto index = find_in( _table.get(), _mask, _shift, hash, match );
+    if ( index == npos && _old_table )
+    {
+      index = find_in( _old_table.get(), _old_mask, _old_shift, hash, match );
+    }
+    return index;
+  }
+
+  /* returns the index for which `match` holds; otherwise, stores the index
+   * returned by `create` in the empty slot found by the same probe */
+  template<typename Match, typename Create, typename Rehash>
+  unsigned find_or_insert( std::size_t hash, Match&& match, Create&& create, Rehash&& rehash )
+  {
+    if ( _old_table )
+    {
+      migrate( rehash );
+    }
+
+    auto pos = home( hash, _shift );
+    for ( ; _table[pos] != 0u; pos = ( pos + 1u ) & _mask )
+    {
+      if ( match( _table[pos] - 1u ) )
+      {
+        return _table[pos] - 1u;
+      }
+    }
+
+    if ( _old_table )
+    {
+      const auto index = find_in( _old_table.get(), _old_mask, _old_shift, hash, match );
+      if ( index != npos )
+      {
+        return index;
+      }
+    }
+
+    const unsigned index = create();
+    if ( !_old_table && 2u * ( _size + 1u ) > _mask + 1u )
+    {
+      /* the probed slot is stale after growing */
+      grow();
+      migrate( rehash );
+      insert_into( _table.get(), _mask, _shift, hash, index );
+    }
+    else
+    {
+      _table[pos] = index + 1u;
+    }
+    ++_size;
+    return index;
+  }
+
+  /* inserts an index that is not yet contained, `rehash` recomputes the
+   * hash value of a stored index during migration */
+  template<typename Rehash>
+  void insert( std::size_t hash, unsigned index, Rehash&& rehash )
+  {
+    if ( _old_table )
+    {
+      migrate( rehash );
+    }
+    else if ( 2u * ( _size + 1u ) > _mask + 1u )
+    {
+      grow();
+      migrate( rehash );
+    }
+
+    insert_into( _table.get(), _mask, _shift, hash, index );
+    ++_size;
+  }
+
+  /* removes a stored index, `rehash` recomputes the hash value of any
+   * stored index; returns false if the index is not contained */
+  template<typename Rehash>
+  bool erase( std::size_t hash, unsigned index, Rehash&& rehash )
+  {
+    if ( _old_table )
+    {
+      /* shifting entries would move them across the migration cursor */
+      while ( _old_table )
+      {
+        migrate( rehash );
+      }
+    }
+
+    if ( !erase_from( _table.get(), _mask, _shift, hash, index, rehash ) )
+    {
+      return false;
+    }
+    --_size;
+    return true;
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  std::size_t capacity() const
+  {
+    return _mask + 1u + ( _old_table ? _old_mask + 1u : 0u );
+  }
+
+  /* probe lengths of all stored indices */
+  template<typename Rehash>
+  strash_statistics statistics( Rehash&& rehash ) const
+  {
+    strash_statistics st;
+    st.size = _size;
+    st.capacity = capacity();
+
+    std::size_t total = 0u;
+    const auto collect = [&]( const unsigned *table, std::size_t mask, unsigned shift, std::size_t begin ){
+      for ( auto pos = begin; pos <= mask; ++pos )
+      {
+        if ( table[pos] == 0u ) continue;
+        const auto length = ( ( pos - home( rehash( table[pos] - 1u ), shift ) ) & mask ) + 1u;
+        st.max_probe_length = std::max( st.max_probe_length, length );
+        total += length;
+      }
+    };
+    collect( _table.get(), _mask, _shift, 0u );
+    if ( _old_table )
+    {
+      /* only count entries that have not been migrated yet */
+      collect( _old_table.get(), _old_mask, _old_shift, _migrated );
+    }
+
+    st.avg_probe_length = _size == 0u ? 0.0 : double( total ) / _size;
+    return st;
+  }
+
+  /* bytes allocated for the slots */
+  std::size_t memory_usage() const
+  {
+    return capacity() * sizeof( unsigned );
+  }
+
+private:
+  struct free_deleter
+  {
+    void operator()( unsigned *p ) const { std::free( p ); }
+  };
+
+  using slots_t = std::unique_ptr<unsigned[], free_deleter>;
+
+  /* Number of old slots migrated per insertion.  Growing doubles the
+   * capacity to c, the old table has c/2 slots, and the new table reaches
+   * its threshold after another c/4 insertions; migration must be done by
+   * then, which needs 2 slots per insertion.  Migrating 8 finishes after
+   * c/16 insertions, so the old table is released four times earlier. */
+  static constexpr std::size_t migration_step = 8u;
+
+  static unsigned shift_for( std::size_t capacity )
+  {
+    auto shift = 64u;
+    for ( ; capacity > 1u; capacity >>= 1u )
+    {
+      --shift;
+    }
+    return shift;
+  }
+
+  static std::size_t home( std::size_t hash, unsigned shift )
+  {
+    return std::size_t( ( std::uint64_t( hash ) * UINT64_C( 0x9e3779b97f4a7c15 ) ) >> shift );
+  }
+
+  static slots_t allocate( std::size_t capacity )
+  {
+    auto *p = static_cast<unsigned*>( std::calloc( capacity, sizeof( unsigned ) ) );
+    if ( !p )
+    {
+      throw std::bad_alloc();
+    }
+    return slots_t( p );
+  }
+
+  template<typename Match>
+  static unsigned find_in( const unsigned *table, std::size_t mask, unsigned shift, std::size_t hash, Match& match )
+  {
+    for ( auto pos = home( hash, shift ); table[pos] != 0u; pos = ( pos + 1u ) & mask )
+    {
+      if ( match( table[pos] - 1u ) )
+      {
+        return table[pos] - 1u;
+      }
+    }
+    return npos;
+  }
+
+  static void insert_into( unsigned *table, std::size_t mask, unsigned shift, std::size_t hash, unsigned index )
+  {
+    auto pos = home( hash, shift );
+    while ( table[pos] != 0u )
+    {
+      pos = ( pos + 1u ) & mask;
+    }
+    table[pos] = index + 1u;
+  }
+
+  /* backward-shift deletion: entries after the freed slot that are not at
+   * their home position move back, so no tombstones are needed */
+  template<typename Rehash>
+  static bool erase_from( unsigned *table, std::size_t mask, unsigned shift, std::size_t hash, unsigned index, Rehash& rehash )
+  {
+    auto pos = home( hash, shift );
+    for ( ; table[pos] != index + 1u; pos = ( pos + 1u ) & mask )
+    {
+      if ( table[pos] == 0u )
+      {
+        return false;
+      }
+    }
+
+    for ( auto next = ( pos + 1u ) & mask; table[next] != 0u; next = ( next + 1u ) & mask )
+    {
+      /* keep the entry if its home lies cyclically in (pos, next] */
+      const auto h = home( rehash( table[next] - 1u ), shift );
+      if ( pos <= next ? ( pos < h && h <= next ) : ( pos < h || h <= next ) )
+      {
+        continue;
+      }
+      table[pos] = table[next];
+      pos = next;
+    }
+    table[pos] = 0u;
+    return true;
+  }
+
+  void grow()
+  {
+    _old_table = std::move( _table );
+    _old_mask = _mask;
+    _old_shift = _shift;
+    _table = allocate( 2u * ( _old_mask + 1u ) );
+    _mask = 2u * _old_mask + 1u;
+    _shift = _old_shift - 1u;
+    _migrated = 0u;
+  }
+
+  /* moves the next few slots of the old table into the new one; entries stay
+   * findable in the old table until it is released */
+  template<typename Rehash>
+  void migrate( Rehash& rehash )
+  {
+    const auto end = std::min<std::size_t>( _migrated + migration_step, _old_mask + 1u );
+    for ( ; _migrated < end; ++_migrated )
+    {
+      const auto slot = _old_table[_migrated];
+      if ( slot != 0u )
+      {
+        insert_into( _table.get(), _mask, _shift, rehash( slot - 1u ), slot - 1u );
+      }
+    }
+
+    if ( _migrated > _old_mask )
+    {
+      _old_table.reset();
+      _old_mask = 0u;
+    }
+  }
+
+  slots_t _table;
+  std::size_t _mask = 0u;
+  unsigned _shift = 64u;
+  std::size_t _size = 0u;
+
+  /* table being migrated from */
+  slots_t _old_table;
+  std::size_t _old_mask = 0u;
+  unsigned _old_shift = 64u;
+  std::size_t _migrated = 0u;
+}; // strash_table
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
@@ -0,0 +1,416 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behemoth/expr.hpp>
+#include <behemoth/node_table.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define BEHEMOTH_TRUTH_TABLE_X86
+#endif
+
+namespace behemoth
+{
+
+/******************************************************************************
+ * truth table kernels                                                        *
+ ******************************************************************************/
+
+/* instruction set used by the word-parallel kernels */
+enum class simd_isa : std::uint8_t
+{
+  scalar,
+  avx2,
+  avx512
+}; // simd_isa
+
+namespace detail
+{
+
+struct tt_and
+{
+  static std::uint64_t apply( std::uint64_t a, std::uint64_t b ) { return a & b; }
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+  __attribute__(( target( "avx2" ) )) static __m256i apply( __m256i a, __m256i b ) { return _mm256_and_si256( a, b ); }
+  __attribute__(( target( "avx512f" ) )) static __m512i apply( __m512i a, __m512i b ) { return _mm512_and_si512( a, b ); }
+#endif
+}; // tt_and
+
+struct tt_or
+{
+  static std::uint64_t apply( std::uint64_t a, std::uint64_t b ) { return a | b; }
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+  __attribute__(( target( "avx2" ) )) static __m256i apply( __m256i a, __m256i b ) { return _mm256_or_si256( a, b ); }
+  __attribute__(( target( "avx512f" ) )) static __m512i apply( __m512i a, __m512i b ) { return _mm512_or_si512( a, b ); }
+#endif
+}; // tt_or
+
+struct tt_xor
+{
+  static std::uint64_t apply( std::uint64_t a, std::uint64_t b ) { return a ^ b; }
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+  __attribute__(( target( "avx2" ) )) static __m256i apply( __m256i a, __m256i b ) { return _mm256_xor_si256( a, b ); }
+  __attribute__(( target( "avx512f" ) )) static __m512i apply( __m512i a, __m512i b ) { return _mm512_xor_si512( a, b ); }
+#endif
+}; // tt_xor
+
+/* out[i] = a[i] op b[i]; `out` may alias `a` or `b` */
+template<typename Op>
+void tt_binary_scalar( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b, std::size_t n )
+{
+  for ( auto i = 0u; i < n; ++i )
+  {
+    out[i] = Op::apply( a[i], b[i] );
+  }
+}
+
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+template<typename Op>
+__attribute__(( target( "avx2" ) )) void tt_binary_avx2( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b, std::size_t n )
+{
+  std::size_t i = 0u;
+  for ( ; i + 4u <= n; i += 4u )
+  {
+    const auto x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( a + i ) );
+    const auto y = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( b + i ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ), Op::apply( x, y ) );
+  }
+  for ( ; i < n; ++i )
+  {
+    out[i] = Op::apply( a[i], b[i] );
+  }
+}
+
+template<typename Op>
+__attribute__(( target( "avx512f" ) )) void tt_binary_avx512( std::uint64_t *out, const std::uint64_t *a, const std::uint64_t *b, std::size_t n )
+{
+  std::size_t i = 0u;
+  for ( ; i + 8u <= n; i += 8u )
+  {
+    const auto x = _mm512_loadu_si512( a + i );
+    const auto y = _mm512_loadu_si512( b + i );
+    _mm512_storeu_si512( out + i, Op::apply( x, y ) );
+  }
+  for ( ; i < n; ++i )
+  {
+    out[i] = Op::apply( a[i], b[i] );
+  }
+}
+#endif
+
+} // namespace detail
+
+/* best instruction set supported by the running processor */
+inline simd_isa detect_simd_isa()
+{
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx512f" ) )
+  {
+    return simd_isa::avx512;
+  }
+  if ( __builtin_cpu_supports( "avx2" ) )
+  {
+    return simd_isa::avx2;
+  }
+#endif
+  return simd_isa::scalar;
+}
+
+inline const char *simd_isa_name( simd_isa isa )
+{
+  switch ( isa )
+  {
+  case simd_isa::avx2: return "avx2";
+  case simd_isa::avx512: return "avx512";
+  default: return "scalar";
+  }
+}
+
+/* word-parallel AND, OR, and XOR of truth tables */
+struct truth_table_kernels
+{
+  using binary_fn = void(*)( std::uint64_t*, const std::uint64_t*, const std::uint64_t*, std::size_t );
+
+  explicit truth_table_kernels( simd_isa isa = detect_simd_isa() )
+  {
+#ifdef BEHEMOTH_TRUTH_TABLE_X86
+    if ( isa == simd_isa::avx512 )
+    {
+      and_ = detail::tt_binary_avx512<detail::tt_and>;
+      or_ = detail::tt_binary_avx512<detail::tt_or>;
+      xor_ = detail::tt_binary_avx512<detail::tt_xor>;
+      this->isa = isa;
+    }
+    else if ( isa == simd_isa::avx2 )
+    {
+      and_ = detail::tt_binary_avx2<detail::tt_and>;
+      or_ = detail::tt_binary_avx2<detail::tt_or>;
+      xor_ = detail::tt_binary_avx2<detail::tt_xor>;
+      this->isa = isa;
+    }
+#else
+    (void)isa;
+#endif
+  }
+
+  binary_fn and_ = detail::tt_binary_scalar<detail::tt_and>;
+  binary_fn or_ = detail::tt_binary_scalar<detail::tt_or>;
+  binary_fn xor_ = detail::tt_binary_scalar<detail::tt_xor>;
+  simd_isa isa = simd_isa::scalar;
+}; // truth_table_kernels
+
+/******************************************************************************
+ * truth_table_evaluator                                                      *
+ ******************************************************************************/
+
+/* Boolean meaning of a function symbol */
+enum class boolean_op : std::uint8_t
+{
+  unknown,  /* not evaluable, e.g., non-terminals */
+  variable,
+  constant0,
+  constant1,
+  not_,
+  and_,
+  or_,
+  xor_
+}; // boolean_op
+
+/* Computes truth tables of concrete expressions over up to 16 variables.
+ *
+ * A truth table of n variables is stored in max(1, 2^n / 64) words, bit j of
+ * the table being the value under the assignment whose bit i is the value of
+ * variable i.  Tables are computed by word-parallel kernels.
+ */
+class truth_table_evaluator : public node_evaluator<truth_table_evaluator, std::uint64_t, boolean_op>
+{
+  using base_t = node_evaluator<truth_table_evaluator, std::uint64_t, boolean_op>;
+  friend base_t;
+
+public:
+  static constexpr unsigned max_num_vars = 16u;
+
+  truth_table_evaluator( const context& ctx, unsigned num_vars, simd_isa isa = detect_simd_isa(), const node_table_params& ps = {} )
+    : base_t( ctx, num_words_for( num_vars ), ps )
+    , _num_vars( num_vars )
+    , _num_words( num_words_for( num_vars ) )
+    , _kernels( isa )
+  {
+    if ( num_vars > max_num_vars )
+    {
+      throw std::invalid_argument( "truth tables support at most 16 variables" );
+    }
+
+    /* NOT is XOR with the constant-1 table */
+    const auto mask = num_vars >= 6u ? ~UINT64_C( 0 ) : ( UINT64_C( 1 ) << ( 1u << num_vars ) ) - 1u;
+    _ones.assign( _num_words, mask );
+  }
+
+  /* `symbol` denotes variable `index` */
+  void add_variable( unsigned symbol, unsigned index )
+  {
+    if ( index >= _num_vars )
+    {
+      throw std::invalid_argument( "variable index out of range" );
+    }
+    set_meaning( symbol, symbol_meaning{ boolean_op::variable, index } );
+  }
+
+  unsigned num_vars() const { return _num_vars; }
+  unsigned num_words() const { return _num_words; }
+  simd_isa isa() const { return _kernels.isa; }
+
+private:
+  /* larger variable counts are rejected by the constructor; the conditional
+   * does not bind a reference to `max_num_vars`, which has no definition */
+  static unsigned num_words_for( unsigned num_vars )
+  {
+    return num_vars <= 6u ? 1u : 1u << ( ( num_vars < max_num_vars ? num_vars : max_num_vars ) - 6u );
+  }
+
+  bool accepts( boolean_op op, std::size_t num_children ) const
+  {
+    switch ( op )
+    {
+    case boolean_op::not_:
+      return num_children == 1u;
+    case boolean_op::and_:
+    case boolean_op::or_:
+    case boolean_op::xor_:
+      return num_children >= 2u;
+    default:
+      return num_children == 0u;
+    }
+  }
+
+  void compute( const symbol_meaning& m, std::uint64_t *out, const std::uint64_t * const *children, std::size_t num_children )
+  {
+    switch ( m.op )
+    {
+    case boolean_op::variable:
+      nth_var( out, m.index );
+      break;
+    case boolean_op::constant0:
+      std::fill( out, out + _num_words, UINT64_C( 0 ) );
+      break;
+    case boolean_op::constant1:
+      std::copy( _ones.begin(), _ones.end(), out );
+      break;
+    case boolean_op::not_:
+      _kernels.xor_( out, children[0u], _ones.data(), _num_words );
+      break;
+    default:
+      {
+        const auto fn = m.op == boolean_op::and_ ? _kernels.and_ : m.op == boolean_op::or_ ? _kernels.or_ : _kernels.xor_;
+        fn( out, children[0u], children[1u], _num_words );
+        for ( auto i = 2u; i < num_children; ++i )
+        {
+          fn( out, out, children[i], _num_words );
+        }
+      }
+      break;
+    }
+  }
+
+  /* projection on variable `i` */
+  void nth_var( std::uint64_t *out, unsigned i ) const
+  {
+    static const std::uint64_t projections[] = {
+      UINT64_C( 0xaaaaaaaaaaaaaaaa ), UINT64_C( 0xcccccccccccccccc ), UINT64_C( 0xf0f0f0f0f0f0f0f0 ),
+      UINT64_C( 0xff00ff00ff00ff00 ), UINT64_C( 0xffff0000ffff0000 ), UINT64_C( 0xffffffff00000000 ) };
+
+    for ( auto w = 0u; w < _num_words; ++w )
+    {
+      out[w] = i < 6u ? projections[i] & _ones[0u] : ( ( w >> ( i - 6u ) ) & 1u ? ~UINT64_C( 0 ) : UINT64_C( 0 ) );
+    }
+  }
+
+  unsigned _num_vars;
+  unsigned _num_words;
+  truth_table_kernels _kernels;
+  std::vector<std::uint64_t> _ones;
+}; // truth_table_evaluator
+
+/******************************************************************************
+ * truth_table_filter                                                         *
+ ******************************************************************************/
+
+/* Observational equivalence: keeps the first expression of every Boolean
+ * function.  If expressions are inserted in nondecreasing cost order, each
+ * function is represented by one of its cheapest expressions.  The tables of
+ * the representatives are copied, such that they survive eviction from the
+ * evaluator. */
+class truth_table_filter
+{
+public:
+  explicit truth_table_filter( truth_table_evaluator& eval )
+    : _eval( eval )
+    , _seen( 1024u, table_hash{ this }, table_equal{ this } )
+  {}
+
+  /* the functors of `_seen` point back to this filter */
+  truth_table_filter( const truth_table_filter& ) = delete;
+  truth_table_filter& operator=( const truth_table_filter& ) = delete;
+
+  /* returns false if the function of `e` was seen before (or `e` cannot be
+   * evaluated), otherwise records it */
+  bool insert( unsigned e )
+  {
+    const auto *t = _eval.evaluate( e );
+    if ( !t )
+    {
+      return false;
+    }
+
+    /* the candidate is looked up as the next table */
+    const auto index = unsigned( _seen.size() );
+    _tables.insert( _tables.end(), t, t + _eval.num_words() );
+    if ( !_seen.insert( index ).second )
+    {
+      _tables.resize( _tables.size() - _eval.num_words() );
+      return false;
+    }
+    return true;
+  }
+
+  /* number of distinct functions */
+  std::size_t size() const
+  {
+    return _seen.size();
+  }
+
+private:
+  const std::uint64_t *table( unsigned index ) const
+  {
+    return _tables.data() + std::size_t( index ) * _eval.num_words();
+  }
+
+  struct table_hash
+  {
+    std::size_t operator()( unsigned index ) const
+    {
+      const auto *t = filter->table( index );
+      std::uint64_t h = 0u;
+      for ( auto w = 0u; w < filter->_eval.num_words(); ++w )
+      {
+        h = expr_hash::mix( h + UINT64_C( 0x9e3779b97f4a7c15 ) + t[w] );
+      }
+      return std::size_t( h );
+    }
+
+    const truth_table_filter *filter;
+  };
+
+  struct table_equal
+  {
+    bool operator()( unsigned a, unsigned b ) const
+    {
+      const auto *ta = filter->table( a );
+      return std::equal( ta, ta + filter->_eval.num_words(), filter->table( b ) );
+    }
+
+    const truth_table_filter *filter;
+  };
+
+  truth_table_evaluator& _eval;
+  std::vector<std::uint64_t> _tables;
+  std::unordered_set<unsigned, table_hash, table_equal> _seen;
+}; // truth_table_filter
+
+} // namespace behemoth
+
+// Local Variables:
+// c-basic-offset: 2
+// eval: (c-set-offset 'substatement-open 0)
+// eval: (c-set-offset 'innamespace 0)
+// End:
@@ -0,0 +1,68 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/arena.hpp>
+#include <behemoth/expr.hpp>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+/* argument lists longer than a chunk are rejected, not written past it */
+void test_append_exceeds_chunk()
+{
+  behemoth::arena_params ps;
+  ps.chunk_size = 64u;
+  behemoth::context ctx( ps );
+
+  const auto x = ctx.make_fun( "x" );
+  const std::vector<unsigned> fits( 16u, x );
+  const std::vector<unsigned> too_long( 17u, x );
+
+  ctx.make_fun( "f", fits );
+
+  auto thrown = false;
+  try
+  {
+    ctx.make_fun( "g", too_long );
+  }
+  catch ( const std::length_error& )
+  {
+    thrown = true;
+  }
+  assert( thrown );
+
+  /* the context is unchanged and usable */
+  assert( ctx.make_fun( "f", fits ) == 1u );
+  assert( ctx.size() == 2u );
+}
+
+int main()
+{
+  test_append_exceeds_chunk();
+  return 0;
+}
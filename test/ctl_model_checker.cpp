@@ -0,0 +1,284 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <behemoth/ctl.hpp>
+#include <cassert>
+#include <random>
+#include <string>
+#include <vector>
+
+struct reference_structure
+{
+  std::vector<std::uint64_t> labels;
+  std::vector<std::vector<unsigned>> successors;
+};
+
+using states_t = std::vector<bool>;
+
+/* random formula of at most `depth` nested operators */
+unsigned random_formula( behemoth::context& ctx, std::mt19937& gen, unsigned depth )
+{
+  static const std::vector<std::string> leaves{ "x0", "x1", "0", "1" };
+  static const std::vector<std::string> unary{ "!", "EX", "AX", "EF", "AF", "EG", "AG" };
+  static const std::vector<std::string> binary{ "&", "|", "EU", "AU" };
+
+  const auto kind = depth == 0u ? 0u : gen() % 3u;
+  if ( kind == 0u )
+  {
+    return ctx.make_fun( leaves[gen() % leaves.size()] );
+  }
+  else if ( kind == 1u )
+  {
+    return ctx.make_fun( unary[gen() % unary.size()], { random_formula( ctx, gen, depth - 1u ) } );
+  }
+  else
+  {
+    const auto a = random_formula( ctx, gen, depth - 1u );
+    const auto b = random_formula( ctx, gen, depth - 1u );
+    return ctx.make_fun( binary[gen() % binary.size()], { a, b } );
+  }
+}
+
+/* states with a successor in `a` */
+states_t ex( const reference_structure& k, const states_t& a )
+{
+  states_t r( k.labels.size(), false );
+  for ( auto s = 0u; s < r.size(); ++s )
+  {
+    for ( const auto t : k.successors[s] )
+    {
+      r[s] = r[s] || a[t];
+    }
+  }
+  return r;
+}
+
+/* states with successors, all of them in `a` */
+states_t ax_strict( const reference_structure& k, const states_t& a )
+{
+  states_t r( k.labels.size(), false );
+  for ( auto s = 0u; s < r.size(); ++s )
+  {
+    r[s] = !k.successors[s].empty();
+    for ( const auto t : k.successors[s] )
+    {
+      r[s] = r[s] && a[t];
+    }
+  }
+  return r;
+}
+
+/* iterates z = f( z ) from `z` until it is stable */
+template<typename Fn>
+states_t fixpoint( states_t z, Fn&& f )
+{
+  for ( auto next = f( z ); next != z; next = f( z ) )
+  {
+    z = next;
+  }
+  return z;
+}
+
+states_t complement( states_t a )
+{
+  a.flip();
+  return a;
+}
+
+/* E[a U b] = mu z. b | ( a & EX z ), A[a U b] = mu z. b | ( a & AX z ) on
+ * states with successors, EG a = nu z. a & EX z */
+states_t reference( const behemoth::context& ctx, unsigned e, const reference_structure& k )
+{
+  const auto n = k.labels.size();
+  const auto& name = ctx.name( e );
+  const auto children = ctx.children( e );
+
+  if ( name[0u] == 'x' )
+  {
+    const auto var = unsigned( std::stoul( name.substr( 1u ) ) );
+    states_t r( n );
+    for ( auto s = 0u; s < n; ++s )
+    {
+      r[s] = ( k.labels[s] >> var ) & 1u;
+    }
+    return r;
+  }
+  if ( name == "0" || name == "1" )
+  {
+    return states_t( n, name == "1" );
+  }
+
+  const auto a = reference( ctx, children[0u], k );
+  const auto b = children.size() == 2u ? reference( ctx, children[1u], k ) : states_t( n, true );
+  const auto eu = [&]( const states_t& a, const states_t& b ) {
+    return fixpoint( states_t( n, false ), [&]( const states_t& z ) {
+      auto r = ex( k, z );
+      for ( auto s = 0u; s < n; ++s )
+      {
+        r[s] = b[s] || ( a[s] && r[s] );
+      }
+      return r;
+    } );
+  };
+  const auto au = [&]( const states_t& a, const states_t& b ) {
+    return fixpoint( states_t( n, false ), [&]( const states_t& z ) {
+      auto r = ax_strict( k, z );
+      for ( auto s = 0u; s < n; ++s )
+      {
+        r[s] = b[s] || ( a[s] && r[s] );
+      }
+      return r;
+    } );
+  };
+  const auto eg = [&]( const states_t& a ) {
+    return fixpoint( states_t( n, true ), [&]( const states_t& z ) {
+      auto r = ex( k, z );
+      for ( auto s = 0u; s < n; ++s )
+      {
+        r[s] = a[s] && r[s];
+      }
+      return r;
+    } );
+  };
+
+  states_t r( n );
+  if ( name == "!" )
+  {
+    r = complement( a );
+  }
+  else if ( name == "&" || name == "|" )
+  {
+    for ( auto s = 0u; s < n; ++s )
+    {
+      r[s] = name == "&" ? a[s] && b[s] : a[s] || b[s];
+    }
+  }
+  else if ( name == "EX" )
+  {
+    r = ex( k, a );
+  }
+  else if ( name == "AX" )
+  {
+    r = complement( ex( k, complement( a ) ) );
+  }
+  else if ( name == "EF" )
+  {
+    r = eu( states_t( n, true ), a );
+  }
+  else if ( name == "AF" )
+  {
+    r = au( states_t( n, true ), a );
+  }
+  else if ( name == "EG" )
+  {
+    r = eg( a );
+  }
+  else if ( name == "AG" )
+  {
+    r = complement( eu( states_t( n, true ), complement( a ) ) );
+  }
+  else if ( name == "EU" )
+  {
+    r = eu( a, b );
+  }
+  else if ( name == "AU" )
+  {
+    r = au( a, b );
+  }
+  return r;
+}
+
+void test_reference( unsigned num_states, behemoth::simd_isa isa )
+{
+  std::mt19937 gen( 7u + num_states );
+
+  /* every fourth state on average is a deadlock */
+  reference_structure ref;
+  behemoth::kripke_structure kripke( 2u );
+  for ( auto s = 0u; s < num_states; ++s )
+  {
+    ref.labels.push_back( gen() % 4u );
+    kripke.add_state( ref.labels.back() );
+  }
+  ref.successors.resize( num_states );
+  for ( auto s = 0u; s < num_states; ++s )
+  {
+    for ( auto i = gen() % 4u; i > 0u; --i )
+    {
+      ref.successors[s].push_back( gen() % num_states );
+      kripke.add_transition( s, ref.successors[s].back() );
+    }
+  }
+  kripke.add_initial_state( 0u );
+  kripke.add_initial_state( num_states - 1u );
+
+  behemoth::context ctx;
+  behemoth::ctl_model_checker checker( ctx, kripke, isa );
+  checker.add_operator( ctx.make_symbol( "0" ), behemoth::ctl_op::constant0 );
+  checker.add_operator( ctx.make_symbol( "1" ), behemoth::ctl_op::constant1 );
+  checker.add_operator( ctx.make_symbol( "!" ), behemoth::ctl_op::not_ );
+  checker.add_operator( ctx.make_symbol( "&" ), behemoth::ctl_op::and_ );
+  checker.add_operator( ctx.make_symbol( "|" ), behemoth::ctl_op::or_ );
+  checker.add_operator( ctx.make_symbol( "EX" ), behemoth::ctl_op::ex );
+  checker.add_operator( ctx.make_symbol( "AX" ), behemoth::ctl_op::ax );
+  checker.add_operator( ctx.make_symbol( "EF" ), behemoth::ctl_op::ef );
+  checker.add_operator( ctx.make_symbol( "AF" ), behemoth::ctl_op::af );
+  checker.add_operator( ctx.make_symbol( "EG" ), behemoth::ctl_op::eg );
+  checker.add_operator( ctx.make_symbol( "AG" ), behemoth::ctl_op::ag );
+  checker.add_operator( ctx.make_symbol( "EU" ), behemoth::ctl_op::eu );
+  checker.add_operator( ctx.make_symbol( "AU" ), behemoth::ctl_op::au );
+  checker.add_variable( ctx.make_symbol( "x0" ), 0u );
+  checker.add_variable( ctx.make_symbol( "x1" ), 1u );
+
+  for ( auto k = 0u; k < 500u; ++k )
+  {
+    const auto e = random_formula( ctx, gen, 3u );
+    const auto *v = checker.evaluate( e );
+    assert( v );
+    const std::vector<std::uint64_t> r( v, v + kripke.num_words() );
+
+    const auto expected = reference( ctx, e, ref );
+    for ( auto s = 0u; s < kripke.num_words() * 64u; ++s )
+    {
+      const bool bit = ( r[s / 64u] >> ( s % 64u ) ) & 1u;
+      assert( bit == ( s < num_states && expected[s] ) );
+    }
+    assert( checker.holds( e ) == ( expected[0u] && expected[num_states - 1u] ) );
+  }
+}
+
+int main()
+{
+  for ( const auto num_states : { 5u, 70u } )
+  {
+    test_reference( num_states, behemoth::simd_isa::scalar );
+    test_reference( num_states, behemoth::detect_simd_isa() );
+  }
+  return 0;
+}
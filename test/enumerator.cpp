@@ -0,0 +1,256 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <behemoth/enumerator.hpp>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+/* stops after the first concrete expression */
+class first_enumerator : public behemoth::enumerator
+{
+public:
+  using enumerator::enumerator;
+
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    (void)e;
+    ++number_of_expressions;
+    signal_termination();
+  }
+
+  unsigned number_of_expressions = 0u;
+}; // first_enumerator
+
+void test_termination( unsigned batch_size )
+{
+  behemoth::context ctx;
+  behemoth::rules_t rules;
+  const auto _N = ctx.make_fun( "_N" );
+  rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( "and", { _N, _N } ) } );
+  for ( const auto& name : { "x0", "x1", "x2" } )
+  {
+    rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( name ) } );
+  }
+
+  first_enumerator en( ctx, rules, 4 );
+  en.add_expression( _N );
+  while ( en.is_running() )
+  {
+    if ( batch_size > 0u )
+    {
+      en.deduce_batch( batch_size );
+    }
+    else
+    {
+      en.deduce();
+    }
+  }
+  assert( en.number_of_expressions == 1u );
+}
+
+/* records the concrete expressions by cost */
+class collecting_enumerator : public behemoth::enumerator
+{
+public:
+  collecting_enumerator( behemoth::context& ctx, const behemoth::rules_t& rules, int max_cost )
+    : enumerator( ctx, rules, max_cost )
+    , printer( ctx )
+  {}
+
+  virtual void on_concrete_expression( behemoth::cexpr_t e ) override
+  {
+    in_cost_order = in_cost_order && e.second >= last_cost;
+    last_cost = e.second;
+    expressions[e.second].insert( printer.as_string( e.first ) );
+    ++number_of_expressions;
+  }
+
+  behemoth::expr_printer printer;
+  std::map<unsigned, std::multiset<std::string>> expressions;
+  unsigned long number_of_expressions = 0u;
+  unsigned last_cost = 0u;
+  bool in_cost_order = true;
+}; // collecting_enumerator
+
+std::map<unsigned, std::multiset<std::string>> enumerate( bool iterative_deepening, bool& in_cost_order )
+{
+  behemoth::context ctx;
+  behemoth::rules_t rules;
+  const auto _N = ctx.make_fun( "_N" );
+  rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( "not", { _N }, behemoth::expr_attr_enum::_no_double_application ), 0u } );
+  rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( "and", { _N, _N }, behemoth::expr_attr_enum::_idempotent | behemoth::expr_attr_enum::_commutative ) } );
+  rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( "or", { _N, _N }, behemoth::expr_attr_enum::_idempotent | behemoth::expr_attr_enum::_commutative ) } );
+  for ( const auto& name : { "x0", "x1", "x2" } )
+  {
+    rules.push_back( behemoth::rule_t{ _N, ctx.make_fun( name ) } );
+  }
+
+  collecting_enumerator en( ctx, rules, 5 );
+  if ( iterative_deepening )
+  {
+    en.use_iterative_deepening();
+  }
+  en.add_expression( _N );
+  while ( en.is_running() )
+  {
+    en.deduce();
+  }
+  in_cost_order = en.in_cost_order;
+  return en.expressions;
+}
+
+/* iterative deepening reports the same expressions per cost as the heap */
+void test_iterative_deepening()
+{
+  bool heap_in_order, deepening_in_order;
+  const auto heap = enumerate( false, heap_in_order );
+  const auto deepening = enumerate( true, deepening_in_order );
+  assert( heap.size() > 1u );
+  assert( deepening == heap );
+  assert( heap_in_order && deepening_in_order );
+}
+
+void check_path( const behemoth::path_t& path, const std::deque<unsigned>& expected )
+{
+  assert( path.size() == expected.size() && path.empty() == expected.empty() );
+  for ( auto i = 0u; i < expected.size(); ++i )
+  {
+    assert( path[i] == expected[i] );
+  }
+}
+
+/* paths behave the same before and after they spill out of the packed word */
+void test_path_spilling()
+{
+  behemoth::path_t path( 0u );
+  std::deque<unsigned> expected;
+  for ( auto i = 0u; i < behemoth::path_t::max_packed_size; ++i )
+  {
+    path.push_back( i % 4u );
+    expected.push_back( i % 4u );
+  }
+  check_path( path, expected );
+
+  /* spills by length */
+  auto longer = path;
+  longer.push_back( 2u );
+  expected.push_back( 2u );
+  check_path( longer, expected );
+  expected.pop_back();
+  check_path( path, expected );
+
+  /* spills by index */
+  behemoth::path_t wide( 0u );
+  wide.push_back( 1u );
+  wide.push_front( 5u );
+  wide.push_back( 3u );
+  check_path( wide, { 5u, 1u, 3u } );
+  wide.pop_front();
+  check_path( wide, { 1u, 3u } );
+
+  std::mt19937 gen( 3u );
+  for ( auto step = 0u; step < 10000u; ++step )
+  {
+    const auto op = gen() % 3u;
+    const auto v = gen() % 16u == 0u ? 4u + gen() % 4u : gen() % 4u;
+    if ( op == 0u && !expected.empty() )
+    {
+      path.pop_front();
+      expected.pop_front();
+    }
+    else if ( op == 1u )
+    {
+      path.push_front( v );
+      expected.push_front( v );
+    }
+    else
+    {
+      path.push_back( v );
+      expected.push_back( v );
+    }
+
+    const auto copy = path;
+    check_path( copy, expected );
+  }
+}
+
+/* refinement along paths that do not fit the packed word */
+void test_long_paths()
+{
+  behemoth::context ctx;
+  behemoth::rules_t rules;
+  const auto _N = ctx.make_fun( "_N" );
+  const auto x = ctx.make_fun( "x" );
+  rules.push_back( behemoth::rule_t{ _N, x } );
+
+  /* non-terminal at depth 40 */
+  auto deep = _N;
+  auto expected = x;
+  for ( auto i = 0u; i < 40u; ++i )
+  {
+    deep = ctx.make_fun( "f", { x, deep } );
+    expected = ctx.make_fun( "f", { x, expected } );
+  }
+
+  /* non-terminal at child index 5 */
+  const auto wide = ctx.make_fun( "g", { x, x, x, x, x, _N } );
+  const auto wide_expected = ctx.make_fun( "g", { x, x, x, x, x, x } );
+
+  behemoth::expr_refiner refiner( ctx );
+  for ( const auto& p : { std::make_pair( deep, expected ), std::make_pair( wide, wide_expected ) } )
+  {
+    const auto path = behemoth::get_path_to_concretizable_element( ctx, p.first );
+    assert( path.size() == ( p.first == deep ? 40u : 1u ) );
+
+    const auto results = behemoth::refine_expression_recurse( ctx, p.first, path, rules );
+    assert( results.size() == 1u && results[0u].first == p.second );
+
+    auto num_results = 0u;
+    refiner.refine( p.first, path, rules, [&]( unsigned e, unsigned cost ) {
+      assert( e == p.second && cost == 1u );
+      ++num_results;
+    } );
+    assert( num_results == 1u );
+  }
+}
+
+int main()
+{
+  test_path_spilling();
+  test_long_paths();
+  test_iterative_deepening();
+  test_termination( 0u );
+  test_termination( 1024u );
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <cassert>
+#include <vector>
+
+class rollback_recorder : public behemoth::context_observer
+{
+public:
+  virtual void on_rollback( unsigned first_id ) override
+  {
+    first_ids.push_back( first_id );
+  }
+
+  std::vector<unsigned> first_ids;
+}; // rollback_recorder
+
+/* creates `n` nodes, every other one with a pooled argument list */
+void add_nodes( behemoth::context& ctx, const std::vector<unsigned>& leaves, unsigned n )
+{
+  auto e = leaves[0u];
+  for ( auto i = 0u; i < n; ++i )
+  {
+    if ( i % 2u == 0u )
+    {
+      e = ctx.make_fun( "and", { e, leaves[i % leaves.size()] } );
+    }
+    else
+    {
+      e = ctx.make_fun( "maj", { leaves[0u], e, leaves[1u], leaves[2u] } );
+    }
+  }
+}
+
+void test_rollback()
+{
+  behemoth::context ctx;
+  rollback_recorder recorder;
+  ctx.attach( recorder );
+
+  const std::vector<unsigned> leaves{ ctx.make_fun( "x0" ), ctx.make_fun( "x1" ), ctx.make_fun( "x2" ), ctx.make_fun( "x3" ) };
+  const auto f = ctx.make_fun( "and", { leaves[0u], leaves[1u] } );
+  const auto g = ctx.make_fun( "maj", { leaves[0u], leaves[1u], leaves[2u], leaves[3u] } );
+
+  /* enough nodes to grow the structural hashing table several times */
+  const auto cp = ctx.checkpoint();
+  const auto num_nodes = ctx.size();
+  add_nodes( ctx, leaves, 5000u );
+  assert( ctx.size() == num_nodes + 5000u );
+  const auto memory = ctx.node_arena().memory_usage();
+
+  ctx.rollback( cp );
+  assert( ctx.size() == num_nodes );
+  assert( recorder.first_ids == std::vector<unsigned>{ unsigned( num_nodes ) } );
+
+  /* old nodes are still hash-consed, new ones reuse the freed ids */
+  assert( ctx.make_fun( "and", { leaves[0u], leaves[1u] } ) == f );
+  assert( ctx.make_fun( "maj", { leaves[0u], leaves[1u], leaves[2u], leaves[3u] } ) == g );
+  assert( ctx.children( g ).size() == 4u && ctx.children( g )[3u] == leaves[3u] );
+  assert( ctx.size() == num_nodes );
+  assert( ctx.make_fun( "and", { f, g } ) == num_nodes );
+
+  /* the memory of the node store is reused */
+  ctx.rollback( cp );
+  add_nodes( ctx, leaves, 5000u );
+  assert( ctx.size() == num_nodes + 5000u );
+  assert( ctx.node_arena().memory_usage() == memory );
+  ctx.rollback( cp );
+
+  ctx.detach( recorder );
+  ctx.rollback( cp );
+  assert( recorder.first_ids.size() == 3u );
+}
+
+void test_nested_rollback()
+{
+  behemoth::context ctx;
+  const auto x0 = ctx.make_fun( "x0" );
+  const auto x1 = ctx.make_fun( "x1" );
+
+  const auto cp1 = ctx.checkpoint();
+  const auto a = ctx.make_fun( "and", { x0, x1 } );
+  const auto cp2 = ctx.checkpoint();
+  const auto b = ctx.make_fun( "or", { a, x1 } );
+
+  ctx.rollback( cp2 );
+  assert( ctx.size() == b );
+  assert( ctx.make_fun( "and", { x0, x1 } ) == a );
+
+  ctx.rollback( cp1 );
+  assert( ctx.size() == a );
+  assert( ctx.make_fun( "or", { x0, x1 } ) == a );
+  assert( ctx.name( a ) == "or" );
+}
+
+int main()
+{
+  test_rollback();
+  test_nested_rollback();
+  return 0;
+}
@@ -0,0 +1,66 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <behemoth/frontier.hpp>
+#include <cassert>
+
+/* pushing the same (expression, cost) pair twice must not be counted twice */
+void test_beam_frontier_duplicates( std::size_t width )
+{
+  behemoth::context ctx;
+  const auto _N = ctx.make_fun( "_N" );
+  const auto x = ctx.make_fun( "x" );
+  const auto e = ctx.make_fun( "and", { _N, x } );
+
+  behemoth::beam_frontier frontier( ctx, width );
+  frontier.push( { e, 1u } );
+  frontier.push( { e, 1u } );
+  frontier.push( { x, 2u } );
+  frontier.push( { x, 2u } );
+  assert( frontier.size() == 2u );
+
+  assert( !frontier.empty() );
+  assert( frontier.top() == behemoth::cexpr_t( e, 1u ) );
+  frontier.pop();
+  assert( !frontier.empty() );
+  assert( frontier.top() == behemoth::cexpr_t( x, 2u ) );
+  frontier.pop();
+  assert( frontier.empty() );
+  assert( frontier.size() == 0u );
+}
+
+int main()
+{
+  test_beam_frontier_duplicates( 1024u );
+
+  /* a full layer must not drop its entry for a duplicate */
+  test_beam_frontier_duplicates( 1u );
+
+  return 0;
+}
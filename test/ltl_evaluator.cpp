@@ -0,0 +1,201 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <behemoth/ltl.hpp>
+#include <cassert>
+#include <random>
+#include <string>
+#include <vector>
+
+using trace_t = std::vector<std::uint64_t>;
+
+/* random formula of at most `depth` nested operators */
+unsigned random_formula( behemoth::context& ctx, std::mt19937& gen, unsigned depth )
+{
+  static const std::vector<std::string> leaves{ "x0", "x1", "x2", "0", "1" };
+  static const std::vector<std::string> unary{ "!", "X", "F", "G" };
+  static const std::vector<std::string> binary{ "&", "|", "U" };
+
+  const auto kind = depth == 0u ? 0u : gen() % 3u;
+  if ( kind == 0u )
+  {
+    return ctx.make_fun( leaves[gen() % leaves.size()] );
+  }
+  else if ( kind == 1u )
+  {
+    return ctx.make_fun( unary[gen() % unary.size()], { random_formula( ctx, gen, depth - 1u ) } );
+  }
+  else
+  {
+    const auto a = random_formula( ctx, gen, depth - 1u );
+    const auto b = random_formula( ctx, gen, depth - 1u );
+    return ctx.make_fun( binary[gen() % binary.size()], { a, b } );
+  }
+}
+
+/* positions of `trace` at which `e` holds, by the finite-trace semantics */
+std::vector<bool> reference( const behemoth::context& ctx, unsigned e, const trace_t& trace )
+{
+  const auto n = trace.size();
+  const auto& name = ctx.name( e );
+  const auto children = ctx.children( e );
+
+  std::vector<bool> r( n, false );
+  if ( name[0u] == 'x' )
+  {
+    const auto var = unsigned( std::stoul( name.substr( 1u ) ) );
+    for ( auto t = 0u; t < n; ++t )
+    {
+      r[t] = ( trace[t] >> var ) & 1u;
+    }
+    return r;
+  }
+  if ( name == "0" || name == "1" )
+  {
+    r.assign( n, name == "1" );
+    return r;
+  }
+
+  const auto a = reference( ctx, children[0u], trace );
+  const auto b = children.size() == 2u ? reference( ctx, children[1u], trace ) : std::vector<bool>();
+  for ( auto t = 0u; t < n; ++t )
+  {
+    if ( name == "!" )
+    {
+      r[t] = !a[t];
+    }
+    else if ( name == "&" )
+    {
+      r[t] = a[t] && b[t];
+    }
+    else if ( name == "|" )
+    {
+      r[t] = a[t] || b[t];
+    }
+    else if ( name == "X" )
+    {
+      r[t] = t + 1u < n && a[t + 1u];
+    }
+    else if ( name == "F" )
+    {
+      for ( auto u = t; u < n && !r[t]; ++u )
+      {
+        r[t] = a[u];
+      }
+    }
+    else if ( name == "G" )
+    {
+      r[t] = true;
+      for ( auto u = t; u < n && r[t]; ++u )
+      {
+        r[t] = a[u];
+      }
+    }
+    else if ( name == "U" )
+    {
+      for ( auto u = t; u < n; ++u )
+      {
+        if ( b[u] )
+        {
+          r[t] = true;
+          break;
+        }
+        if ( !a[u] )
+        {
+          break;
+        }
+      }
+    }
+  }
+  return r;
+}
+
+void test_reference( behemoth::simd_isa isa )
+{
+  std::mt19937 gen( 42u );
+
+  /* lengths around word boundaries */
+  std::vector<trace_t> traces;
+  behemoth::trace_set set( 3u );
+  for ( const auto length : { 1u, 5u, 63u, 64u, 65u, 130u } )
+  {
+    trace_t trace( length );
+    for ( auto& step : trace )
+    {
+      step = gen() % 8u;
+    }
+    traces.push_back( trace );
+    set.add_trace( trace );
+  }
+
+  behemoth::context ctx;
+  behemoth::ltl_evaluator eval( ctx, set, isa );
+  eval.add_operator( ctx.make_symbol( "0" ), behemoth::ltl_op::constant0 );
+  eval.add_operator( ctx.make_symbol( "1" ), behemoth::ltl_op::constant1 );
+  eval.add_operator( ctx.make_symbol( "!" ), behemoth::ltl_op::not_ );
+  eval.add_operator( ctx.make_symbol( "&" ), behemoth::ltl_op::and_ );
+  eval.add_operator( ctx.make_symbol( "|" ), behemoth::ltl_op::or_ );
+  eval.add_operator( ctx.make_symbol( "X" ), behemoth::ltl_op::next );
+  eval.add_operator( ctx.make_symbol( "F" ), behemoth::ltl_op::eventually );
+  eval.add_operator( ctx.make_symbol( "G" ), behemoth::ltl_op::globally );
+  eval.add_operator( ctx.make_symbol( "U" ), behemoth::ltl_op::until );
+  for ( auto i = 0u; i < 3u; ++i )
+  {
+    eval.add_variable( ctx.make_symbol( "x" + std::to_string( i ) ), i );
+  }
+
+  for ( auto k = 0u; k < 500u; ++k )
+  {
+    const auto e = random_formula( ctx, gen, 4u );
+    const auto *v = eval.evaluate( e );
+    assert( v );
+    const std::vector<std::uint64_t> r( v, v + set.num_words() );
+
+    auto count = 0u;
+    for ( auto i = 0u; i < traces.size(); ++i )
+    {
+      const auto expected = reference( ctx, e, traces[i] );
+      for ( auto t = 0u; t < set.num_words( i ) * 64u; ++t )
+      {
+        const bool bit = ( r[set.first_word( i ) + t / 64u] >> ( t % 64u ) ) & 1u;
+        assert( bit == ( t < expected.size() && expected[t] ) );
+      }
+      assert( eval.holds( e, i ) == expected[0u] );
+      count += expected[0u];
+    }
+    assert( eval.count_traces( e ) == count );
+  }
+}
+
+int main()
+{
+  test_reference( behemoth::simd_isa::scalar );
+  test_reference( behemoth::detect_simd_isa() );
+  return 0;
+}
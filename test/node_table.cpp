@@ -0,0 +1,86 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/expr.hpp>
+#include <behemoth/node_table.hpp>
+#include <behemoth/truth_table.hpp>
+#include <cassert>
+
+/* values of rolled back nodes must not be returned for reused ids */
+void test_rollback()
+{
+  behemoth::context ctx;
+  const auto x0 = ctx.make_fun( "x0" );
+  const auto x1 = ctx.make_fun( "x1" );
+
+  behemoth::truth_table_evaluator eval( ctx, 2u );
+  eval.add_variable( ctx.make_symbol( "x0" ), 0u );
+  eval.add_variable( ctx.make_symbol( "x1" ), 1u );
+  eval.add_operator( ctx.make_symbol( "and" ), behemoth::boolean_op::and_ );
+  eval.add_operator( ctx.make_symbol( "or" ), behemoth::boolean_op::or_ );
+
+  const auto cp = ctx.checkpoint();
+  const auto f = ctx.make_fun( "and", { x0, x1 } );
+  assert( eval.evaluate( f )[0u] == 0x8u );
+
+  ctx.rollback( cp );
+  const auto g = ctx.make_fun( "or", { x0, x1 } );
+  assert( g == f );
+  assert( eval.evaluate( g )[0u] == 0xeu );
+  assert( eval.evaluate( x0 )[0u] == 0xau );
+}
+
+void test_eviction()
+{
+  behemoth::node_table_params ps;
+  ps.max_bytes = 2u * sizeof( unsigned );
+  behemoth::node_table<unsigned> table( 1u, ps );
+
+  for ( auto id = 0u; id < 4u; ++id )
+  {
+    *table.insert( id ) = id;
+  }
+  assert( table.size() == 2u );
+  assert( table.num_evictions() == 2u );
+
+  table.truncate( 0u );
+  assert( table.size() == 0u );
+  *table.insert( 5u ) = 5u;
+  assert( *table.find( 5u ) == 5u );
+  assert( table.num_evictions() == 2u );
+
+  table.clear();
+  assert( table.size() == 0u && table.num_evictions() == 0u );
+}
+
+int main()
+{
+  test_rollback();
+  test_eviction();
+  return 0;
+}
@@ -0,0 +1,135 @@
+/* behemoth: A syntax-guided synthesis library
+ * Copyright (C) 2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* assertions are the checks of this test */
+#undef NDEBUG
+
+#include <behemoth/strash.hpp>
+#include <cassert>
+#include <functional>
+#include <random>
+#include <set>
+#include <vector>
+
+/* stores keys[i] as index i; few hash values force long probe sequences,
+ * and multiples of the Fibonacci number 144 have their home slots just
+ * before the end of the table, such that these sequences wrap around */
+class key_table
+{
+public:
+  bool insert( unsigned key )
+  {
+    const auto size = _table.size();
+    const auto index = _table.find_or_insert( hash( key ),
+                                              [&]( unsigned i ) { return _keys[i] == key; },
+                                              [&]() { _keys.push_back( key ); return unsigned( _keys.size() - 1u ); },
+                                              rehash() );
+    assert( _keys[index] == key );
+    return _table.size() != size;
+  }
+
+  bool erase( unsigned key )
+  {
+    const auto index = find( key );
+    if ( index == behemoth::strash_table::npos )
+    {
+      return false;
+    }
+    const auto erased = _table.erase( hash( key ), index, rehash() );
+    assert( erased );
+    return true;
+  }
+
+  unsigned find( unsigned key ) const
+  {
+    return _table.find( hash( key ), [&]( unsigned i ) { return _keys[i] == key; } );
+  }
+
+  /* whether an old table is being migrated */
+  bool migrating() const
+  {
+    const auto c = _table.capacity();
+    return ( c & ( c - 1u ) ) != 0u;
+  }
+
+  const behemoth::strash_table& table() const
+  {
+    return _table;
+  }
+
+private:
+  static std::size_t hash( unsigned key )
+  {
+    return ( key % 13u ) * 144u;
+  }
+
+  std::function<std::size_t( unsigned )> rehash() const
+  {
+    return [this]( unsigned i ) { return hash( _keys[i] ); };
+  }
+
+  behemoth::strash_table _table{ 16u };
+  std::vector<unsigned> _keys;
+}; // key_table
+
+void test_erase_during_migration()
+{
+  std::mt19937 gen( 1u );
+  key_table table;
+  std::set<unsigned> expected;
+  auto num_erased_while_migrating = 0u;
+
+  for ( auto step = 0u; step < 20000u; ++step )
+  {
+    const auto key = unsigned( gen() % 2048u );
+    if ( gen() % 3u == 0u )
+    {
+      const auto migrating = table.migrating();
+      const auto erased = table.erase( key );
+      assert( erased == ( expected.erase( key ) == 1u ) );
+      num_erased_while_migrating += migrating && erased;
+    }
+    else
+    {
+      assert( table.insert( key ) == expected.insert( key ).second );
+    }
+
+    assert( table.table().size() == expected.size() );
+    if ( step % 64u == 0u )
+    {
+      for ( auto k = 0u; k < 2048u; ++k )
+      {
+        assert( ( table.find( k ) != behemoth::strash_table::npos ) == ( expected.count( k ) == 1u ) );
+      }
+    }
+  }
+  assert( num_erased_while_migrating > 0u );
+}
+
+int main()
+{
+  test_erase_during_migration();
+  return 0;
+}